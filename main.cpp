@@ -18,7 +18,7 @@
  *   - Config file persistence
  *
  * Build:
- *   g++ -std=c++17 -O2 -Wall -Wextra -o relix main.cpp \
+ *   g++ -std=c++17 -O2 -Wall -Wextra -DRELIX_HAVE_NCURSESW -o relix main.cpp \
  *       -lncursesw -lpthread
  *
  * CMake:
@@ -31,33 +31,51 @@
 
 /* ─── system headers ──────────────────────────────────────────────────────── */
 #include <ncurses.h>
+#include <langinfo.h>
 
 #include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <chrono>
+#include <climits>
+#include <clocale>
 #include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <cwchar>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <regex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 /* POSIX / Linux */
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <fnmatch.h>
 #include <netdb.h>
+#include <poll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -89,15 +107,91 @@ static bool containsCI(const std::string& haystack, const std::string& needle) {
     return toLower(haystack).find(toLower(needle)) != std::string::npos;
 }
 
+// "12.3 MB" style size for status text
+static std::string humanBytes(uint64_t n) {
+    static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double v = (double)n;
+    int u = 0;
+    while (v >= 1024.0 && u < 4) { v /= 1024.0; u++; }
+    char buf[32];
+    if (u == 0) snprintf(buf, sizeof(buf), "%llu B", (unsigned long long)n);
+    else        snprintf(buf, sizeof(buf), "%.1f %s", v, units[u]);
+    return buf;
+}
+
+// stdout of a shell command, one entry per line (empty if it failed)
+static std::vector<std::string> commandLines(const std::string& cmd) {
+    std::vector<std::string> out;
+    FILE* p = popen(cmd.c_str(), "r");
+    if (!p) return out;
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), p)) {
+        std::string l = buf;
+        while (!l.empty() && (l.back() == '\n' || l.back() == '\r')) l.pop_back();
+        out.push_back(std::move(l));
+    }
+    pclose(p);
+    return out;
+}
+
+// Single-quoted for /bin/sh
+static std::string shellQuote(const std::string& s) {
+    std::string q = "'";
+    for (char c : s) {
+        if (c == '\'') q += "'\\''";
+        else q += c;
+    }
+    return q + "'";
+}
+
+/* ─── UTF-8 display width (requires setlocale(LC_ALL, "")) ───────────────── */
+
+// Longest prefix of `s` that fits in `cols` terminal columns.  Control
+// characters (tabs in .list lines) become single spaces; invalid bytes are
+// shown as '?'.  `used` receives the number of columns the result occupies.
+static std::string fitColumns(const std::string& s, int cols, int* used = nullptr) {
+    std::string out;
+    out.reserve(s.size());
+    std::mbstate_t st{};
+    int w = 0;
+    size_t i = 0;
+    while (i < s.size()) {
+        wchar_t wc = 0;
+        size_t n = std::mbrtowc(&wc, s.data() + i, s.size() - i, &st);
+        const char* bytes = s.data() + i;
+        size_t      len   = n;
+        int         cw;
+        if (n == (size_t)-1 || n == (size_t)-2 || n == 0) {
+            st = std::mbstate_t{};
+            bytes = "?"; len = 1; cw = 1; n = 1;
+        } else {
+            cw = wcwidth(wc);
+            if (cw < 0) { bytes = " "; len = 1; cw = 1; }
+        }
+        if (w + cw > cols) break;
+        out.append(bytes, len);
+        w += cw;
+        i += n;
+    }
+    if (used) *used = w;
+    return out;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 2 — CONFIG  (~/.config/relix/config)
  * ═══════════════════════════════════════════════════════════════════════════ */
 
 struct Config {
     int         themeIndex   = 0;  // 0=dark 1=light 2=solarized 3=monokai
-    int         sortMode     = 0;  // 0=file 1=status 2=alpha
+    int         sortMode     = 0;  // 0=file 1=status 2=alpha 3=freshness
     std::string backupDir    = "/var/backups/relix";
     bool        confirmToggle = false;
+    int         backupKeep   = 0;  // backups kept per source file (0 = unlimited)
+    bool        autoMeta     = false; // fetch metadata once the selection settles
+    std::string renderer     = "ncurses"; // "ncurses" | "native" (env RELIX_RENDERER overrides)
+    int         staleDays    = 7;  // local index not refreshed for longer: stale
+    int         expiryWarnHours = 48; // Valid-Until closer than this: expiring
+    int         speedtestKbps = 4096; // total rate cap of the mirror speed test (1/4 per fetch)
 };
 
 static Config g_cfg;
@@ -108,6 +202,14 @@ static std::string configPath() {
                 : "/tmp/relix.config";
 }
 
+// Rebuildable caches (indexes, snapshots): $XDG_CACHE_HOME/relix or ~/.cache/relix
+static std::string cacheDir() {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/relix";
+    const char* home = getenv("HOME");
+    return home ? std::string(home) + "/.cache/relix" : "/tmp/relix.cache";
+}
+
 static void loadConfig() {
     std::ifstream f(configPath());
     if (!f.is_open()) return;
@@ -121,9 +223,19 @@ static void loadConfig() {
         else if (key == "sort")          { try { g_cfg.sortMode     = std::stoi(val); } catch (...) {} }
         else if (key == "backup_dir")    { g_cfg.backupDir    = val; }
         else if (key == "confirmToggle") { g_cfg.confirmToggle = (val == "1"); }
+        else if (key == "backup_keep")   { try { g_cfg.backupKeep   = std::stoi(val); } catch (...) {} }
+        else if (key == "auto_meta")     { g_cfg.autoMeta     = (val == "1"); }
+        else if (key == "renderer")      { g_cfg.renderer     = val; }
+        else if (key == "stale_days")    { try { g_cfg.staleDays    = std::stoi(val); } catch (...) {} }
+        else if (key == "expiry_warn_hours") { try { g_cfg.expiryWarnHours = std::stoi(val); } catch (...) {} }
+        else if (key == "speedtest_kbps") { try { g_cfg.speedtestKbps = std::stoi(val); } catch (...) {} }
     }
     g_cfg.themeIndex = std::max(0, std::min(3, g_cfg.themeIndex));
-    g_cfg.sortMode   = std::max(0, std::min(2, g_cfg.sortMode));
+    g_cfg.sortMode   = std::max(0, std::min(3, g_cfg.sortMode));
+    g_cfg.staleDays  = std::max(1, g_cfg.staleDays);
+    g_cfg.expiryWarnHours = std::max(0, g_cfg.expiryWarnHours);
+    g_cfg.speedtestKbps = std::max(64, g_cfg.speedtestKbps);
+    g_cfg.backupKeep = std::max(0, g_cfg.backupKeep);
 }
 
 static void saveConfig() {
@@ -134,7 +246,13 @@ static void saveConfig() {
     f << "theme="         << g_cfg.themeIndex   << "\n"
       << "sort="          << g_cfg.sortMode      << "\n"
       << "backup_dir="    << g_cfg.backupDir     << "\n"
-      << "confirmToggle=" << (g_cfg.confirmToggle ? 1 : 0) << "\n";
+      << "confirmToggle=" << (g_cfg.confirmToggle ? 1 : 0) << "\n"
+      << "backup_keep="   << g_cfg.backupKeep    << "\n"
+      << "auto_meta="     << (g_cfg.autoMeta ? 1 : 0) << "\n"
+      << "renderer="      << g_cfg.renderer      << "\n"
+      << "stale_days="    << g_cfg.staleDays     << "\n"
+      << "expiry_warn_hours=" << g_cfg.expiryWarnHours << "\n"
+      << "speedtest_kbps=" << g_cfg.speedtestKbps << "\n";
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
@@ -279,6 +397,19 @@ static OSInfo detectOS() {
     return info;
 }
 
+// dpkg's native architecture first, then any foreign ones (computed once)
+static const std::vector<std::string>& systemArchitectures() {
+    static const std::vector<std::string> archs = [] {
+        std::vector<std::string> a = commandLines("dpkg --print-architecture 2>/dev/null");
+        if (a.empty() || a[0].empty()) a = {"amd64"};
+        a.resize(1);
+        for (auto& f : commandLines("dpkg --print-foreign-architectures 2>/dev/null"))
+            if (!f.empty() && f != a[0]) a.push_back(f);
+        return a;
+    }();
+    return archs;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 5 — REPO STRUCT + GLOBALS
  * ═══════════════════════════════════════════════════════════════════════════ */
@@ -294,27 +425,229 @@ struct RepoEntry {
     std::string suite;
     std::string components;
     std::string types;
+    std::string archs;      // arch= / Architectures: restriction, space-separated ("" = all)
 };
 
 static std::vector<RepoEntry> g_repos;      // master list
+static uint64_t               g_reposGen = 0; // bumped whenever g_repos is rebuilt
 static std::vector<int>       g_filtered;   // indices into g_repos after filter/sort
 static OSInfo                 g_os;
 static bool                   g_isRoot   = false;
 static bool                   g_readOnly = false;
 
 /* ─── undo stack ─────────────────────────────────────────────────────────── */
-struct UndoEntry {
+struct UndoFile {
     std::string file;
     std::vector<std::string> lines;
 };
+struct UndoEntry {
+    std::vector<UndoFile> files;     // one step: all restored together
+};
 static std::vector<UndoEntry> g_undoStack;
 static constexpr size_t k_maxUndo = 20;
 
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 5A — BACKGROUND JOB SCHEDULER
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  All background work goes through one priority queue instead of ad-hoc
+//  detached threads.  Jobs are ordered by class, then earliest deadline, then
+//  submission order.  Worker 0 only runs Interactive jobs, so whatever the
+//  user is looking at never waits behind a bulk scan.  Lower classes call
+//  ctx.yield() between units of work and pause while keys are arriving.
+
+enum class JobClass { Interactive = 0, Prefetch = 1, Bulk = 2, Maintenance = 3 };
+
+using SteadyClock = std::chrono::steady_clock;
+
+class Scheduler;
+
+struct JobCtx {
+    Scheduler*                          sched;
+    JobClass                            cls;
+    std::shared_ptr<std::atomic<bool>>  cancel;
+
+    bool cancelled() const { return cancel->load(); }
+    // Pause while the user is typing; returns false if the job was cancelled
+    bool yield();
+};
+
+class Scheduler {
+public:
+    static constexpr int k_inputQuietMs = 150; // background waits this long after a key
+
+    void start(int workers) {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        if (!m_threads.empty()) return;
+        workers = std::max(2, workers);
+        for (int i = 0; i < workers; i++)
+            m_threads.emplace_back([this, i]{ workerLoop(i == 0); });
+    }
+
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            m_stop = true;
+            for (auto& j : m_queue)   j.cancel->store(true);
+            for (auto& c : m_running) c->store(true);
+            m_queue.clear();
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads) if (t.joinable()) t.join();
+        m_threads.clear();
+    }
+
+    // Queue `fn`.  A job whose deadline has already passed when a worker
+    // picks it up is dropped (prefetch results nobody will look at).
+    std::shared_ptr<std::atomic<bool>> submit(JobClass cls, std::function<void(JobCtx&)> fn,
+                                              SteadyClock::time_point deadline = SteadyClock::time_point::max(),
+                                              std::shared_ptr<std::atomic<bool>> cancel = nullptr) {
+        if (!cancel) cancel = std::make_shared<std::atomic<bool>>(false);
+        {
+            std::lock_guard<std::mutex> lk(m_mtx);
+            if (m_stop) { cancel->store(true); return cancel; }
+            m_queue.push_back({cls, deadline, m_seq++, std::move(fn), cancel});
+        }
+        m_cv.notify_all();
+        return cancel;
+    }
+
+    // Cancel every queued or running job of class `cls`
+    void cancelClass(JobClass cls) {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        for (auto& j : m_queue) if (j.cls == cls) j.cancel->store(true);
+        m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(),
+                      [cls](const Job& j){ return j.cls == cls; }), m_queue.end());
+        for (size_t i = 0; i < m_running.size(); i++)
+            if (m_runningCls[i] == cls) m_running[i]->store(true);
+    }
+
+    // Called by the event loop for every key / mouse event
+    void noteInput() { m_lastInput = SteadyClock::now().time_since_epoch().count(); }
+
+    bool inputActive() const {
+        auto last = SteadyClock::time_point(SteadyClock::duration(m_lastInput.load()));
+        return SteadyClock::now() - last < std::chrono::milliseconds(k_inputQuietMs);
+    }
+
+    bool interactivePending() const { return m_interactiveQueued.load() > 0; }
+
+    int pending(JobClass cls) {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        int n = 0;
+        for (const auto& j : m_queue) if (j.cls == cls) n++;
+        for (auto c : m_runningCls)   if (c == cls) n++;
+        return n;
+    }
+
+private:
+    struct Job {
+        JobClass                            cls;
+        SteadyClock::time_point             deadline;
+        uint64_t                            seq;
+        std::function<void(JobCtx&)>        fn;
+        std::shared_ptr<std::atomic<bool>>  cancel;
+    };
+
+    static bool before(const Job& a, const Job& b) {
+        if (a.cls != b.cls)           return a.cls < b.cls;
+        if (a.deadline != b.deadline) return a.deadline < b.deadline;
+        return a.seq < b.seq;
+    }
+
+    void workerLoop(bool interactiveOnly) {
+        std::unique_lock<std::mutex> lk(m_mtx);
+        while (true) {
+            auto pick = m_queue.end();
+            m_cv.wait(lk, [&]{
+                if (m_stop) return true;
+                pick = m_queue.end();
+                for (auto it = m_queue.begin(); it != m_queue.end(); ++it) {
+                    if (interactiveOnly && it->cls != JobClass::Interactive) continue;
+                    if (pick == m_queue.end() || before(*it, *pick)) pick = it;
+                }
+                return pick != m_queue.end();
+            });
+            if (m_stop) return;
+
+            Job job = std::move(*pick);
+            m_queue.erase(pick);
+            updateInteractiveCount();
+            if (job.cancel->load() || SteadyClock::now() > job.deadline) continue;
+
+            m_running.push_back(job.cancel);
+            m_runningCls.push_back(job.cls);
+            lk.unlock();
+            JobCtx ctx{this, job.cls, job.cancel};
+            try { job.fn(ctx); } catch (...) {} // a failed job must not kill the worker
+            lk.lock();
+            for (size_t i = 0; i < m_running.size(); i++) {
+                if (m_running[i] == job.cancel) {
+                    m_running.erase(m_running.begin() + (long)i);
+                    m_runningCls.erase(m_runningCls.begin() + (long)i);
+                    break;
+                }
+            }
+        }
+    }
+
+    void updateInteractiveCount() {
+        int n = 0;
+        for (const auto& j : m_queue) if (j.cls == JobClass::Interactive) n++;
+        m_interactiveQueued = n;
+    }
+
+    std::mutex                                       m_mtx;
+    std::condition_variable                          m_cv;
+    std::vector<Job>                                 m_queue;
+    std::vector<std::shared_ptr<std::atomic<bool>>>  m_running;
+    std::vector<JobClass>                            m_runningCls;
+    std::vector<std::thread>                         m_threads;
+    uint64_t                                         m_seq  = 0;
+    bool                                             m_stop = false;
+    std::atomic<int>                                 m_interactiveQueued{0};
+    std::atomic<SteadyClock::rep>                    m_lastInput{0};
+};
+
+static Scheduler g_sched;
+
+// Bumped (from any thread) when background results change what panes show
+static std::atomic<uint64_t> g_uiEpoch{0};
+
+// Continuations posted by jobs, run on the main thread between frames
+// (runUiPosts, Section 20A) once no dialog is open
+static std::mutex                         g_uiPostMtx;
+static std::vector<std::function<void()>> g_uiPosts;
+
+static void postToUi(std::function<void()> fn) {
+    std::lock_guard<std::mutex> lk(g_uiPostMtx);
+    g_uiPosts.push_back(std::move(fn));
+    g_uiEpoch++;
+}
+
+// Token for a main-thread "job running" flag.  Capture it in the job: once
+// the last copy is gone (the job ran, was cancelled, dropped from the queue
+// or threw) `flag` is cleared on the main thread.
+static std::shared_ptr<void> clearOnUi(bool& flag) {
+    bool* f = &flag;
+    return std::shared_ptr<void>(nullptr, [f](void*) { postToUi([f] { *f = false; }); });
+}
+
+bool JobCtx::yield() {
+    if (cls == JobClass::Interactive) return !cancelled();
+    // Bounded back-off: a held key must not stall background work forever
+    for (int i = 0; i < 40 && !cancelled(); i++) {
+        if (!sched->inputActive() && !sched->interactivePending()) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    }
+    return !cancelled();
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 6 — PARSE FILES
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-static void parseListFile(const std::string& path) {
+static void parseListFile(const std::string& path, std::vector<RepoEntry>& out) {
     std::ifstream file(path);
     if (!file.is_open()) return;
     std::string line;
@@ -335,20 +668,35 @@ static void parseListFile(const std::string& path) {
         e.enabled    = enabled;
         e.isDeb822   = false;
         e.blockIndex = -1;
-        e.types      = "deb";
-        if (words.size() > 1) e.uri       = words[1];
-        if (words.size() > 2) e.suite     = words[2];
-        if (words.size() > 3) {
-            for (size_t i = 3; i < words.size(); i++) {
+        e.types      = words.empty() ? "deb" : words[0];
+        // Optional "[key=value ...]" block between type and URI
+        size_t wi = 1;
+        if (wi < words.size() && words[wi][0] == '[') {
+            for (; wi < words.size(); wi++) {
+                std::string opt = words[wi];
+                bool last = (opt.back() == ']');
+                if (opt[0] == '[') opt.erase(0, 1);
+                if (last && !opt.empty()) opt.pop_back();
+                if (opt.rfind("arch=", 0) == 0) {
+                    e.archs = opt.substr(5);
+                    std::replace(e.archs.begin(), e.archs.end(), ',', ' ');
+                }
+                if (last) { wi++; break; }
+            }
+        }
+        if (words.size() > wi)     e.uri   = words[wi];
+        if (words.size() > wi + 1) e.suite = words[wi + 1];
+        if (words.size() > wi + 2) {
+            for (size_t i = wi + 2; i < words.size(); i++) {
                 if (!e.components.empty()) e.components += " ";
                 e.components += words[i];
             }
         }
-        g_repos.push_back(std::move(e));
+        out.push_back(std::move(e));
     }
 }
 
-static void parseSourcesFile(const std::string& path) {
+static void parseSourcesFile(const std::string& path, std::vector<RepoEntry>& out) {
     std::ifstream file(path);
     if (!file.is_open()) return;
 
@@ -357,7 +705,7 @@ static void parseSourcesFile(const std::string& path) {
     int blockIndex = 0;
 
     auto processBlock = [&](const std::vector<std::string>& blines) {
-        std::string              types, uri_raw, suites_raw, comp_raw;
+        std::string              types, uri_raw, suites_raw, comp_raw, arch_raw;
         std::vector<std::string> uris, suites, comps;
         bool                     enabled = true;
 
@@ -368,6 +716,7 @@ static void parseSourcesFile(const std::string& path) {
             else if (l.rfind("URIs:",       0) == 0) { uri_raw   = trimStr(l.substr(5)); uris   = splitWords(uri_raw); }
             else if (l.rfind("Suites:",     0) == 0) { suites_raw= trimStr(l.substr(7)); suites = splitWords(suites_raw); }
             else if (l.rfind("Components:", 0) == 0) { comp_raw  = trimStr(l.substr(11)); comps  = splitWords(comp_raw); }
+            else if (l.rfind("Architectures:", 0) == 0) arch_raw = trimStr(l.substr(14));
             else if (l.rfind("Enabled:",    0) == 0) {
                 std::string v = trimStr(l.substr(8));
                 enabled = (v == "yes" || v == "Yes" || v == "YES");
@@ -395,7 +744,8 @@ static void parseSourcesFile(const std::string& path) {
                 e.uri        = u;
                 e.suite      = s;
                 e.components = comp_raw;
-                g_repos.push_back(std::move(e));
+                e.archs      = arch_raw;
+                out.push_back(std::move(e));
             }
         }
         blockIndex++;
@@ -416,18 +766,30 @@ static void parseSourcesFile(const std::string& path) {
  * ═══════════════════════════════════════════════════════════════════════════ */
 
 static std::string g_filterStr;
+static uint64_t    g_filteredGen = 0;   // bumped whenever g_filtered is rebuilt
+
+static bool pkgSearchHides(const RepoEntry& r);   // Section 13G
+static int  freshnessRank(const RepoEntry& r);    // Section 13I
 
 static void rebuildFiltered() {
     g_filtered.clear();
+    g_filteredGen++;
     for (int i = 0; i < (int)g_repos.size(); i++) {
-        if (g_filterStr.empty() || containsCI(g_repos[i].display, g_filterStr))
+        if ((g_filterStr.empty() || containsCI(g_repos[i].display, g_filterStr)) &&
+            !pkgSearchHides(g_repos[i]))
             g_filtered.push_back(i);
     }
     // Sort
+    std::vector<int> rank(g_cfg.sortMode == 3 ? g_repos.size() : 0, 0);
+    if (g_cfg.sortMode == 3)
+        for (int i : g_filtered) rank[i] = freshnessRank(g_repos[i]);
     auto cmp = [&](int a, int b) -> bool {
         const auto& ra = g_repos[a];
         const auto& rb = g_repos[b];
         switch (g_cfg.sortMode) {
+            case 3: // most urgent freshness problem first, then alpha
+                if (rank[a] != rank[b]) return rank[a] < rank[b];
+                return toLower(ra.display) < toLower(rb.display);
             case 1: // status first (enabled first), then alpha
                 if (ra.enabled != rb.enabled) return ra.enabled > rb.enabled;
                 return ra.display < rb.display;
@@ -441,15 +803,16 @@ static void rebuildFiltered() {
     std::stable_sort(g_filtered.begin(), g_filtered.end(), cmp);
 }
 
-static void loadRepos() {
-    g_repos.clear();
+// Source files in the order APT reads them
+static std::vector<std::string> repoSourceFiles() {
     bool useDeb822 = ((g_os.id == "ubuntu" && g_os.version >= 22.04) ||
                       (g_os.id == "debian"  && g_os.version >= 12.0));
 
     const std::string mainList = "/etc/apt/sources.list";
     const std::string dir      = "/etc/apt/sources.list.d/";
 
-    if (fs::exists(mainList)) parseListFile(mainList);
+    std::vector<std::string> files;
+    if (fs::exists(mainList)) files.push_back(mainList);
     if (fs::exists(dir)) {
         // Sort directory entries for deterministic order
         std::vector<fs::directory_entry> entries(fs::directory_iterator(dir),
@@ -457,19 +820,153 @@ static void loadRepos() {
         std::sort(entries.begin(), entries.end());
         for (const auto& e : entries) {
             auto ext = e.path().extension();
-            if (ext == ".list")
-                parseListFile(e.path().string());
-            else if (useDeb822 && ext == ".sources")
-                parseSourcesFile(e.path().string());
+            if (ext == ".list" || (useDeb822 && ext == ".sources"))
+                files.push_back(e.path().string());
         }
     }
+    return files;
+}
+
+static void parseSourceFile(const std::string& path, std::vector<RepoEntry>& out) {
+    if (fs::path(path).extension() == ".sources") parseSourcesFile(path, out);
+    else                                          parseListFile(path, out);
+}
+
+static void cancelRepoLoad();   // Section 7A
+
+static void loadRepos() {
+    cancelRepoLoad();
+    g_repos.clear();
+    g_reposGen++;
+    for (const auto& f : repoSourceFiles()) parseSourceFile(f, g_repos);
+    rebuildFiltered();
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 7A — BACKGROUND REPO LOADER
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Startup and F6 paint the UI first and parse source files on a worker.
+//  Each finished file is handed over as one batch; the main loop appends
+//  batches to g_repos (indices already handed out never move) and rebuilds
+//  the filtered view, so navigation and search work on partial data.
+
+struct RepoLoader {
+    std::mutex             mtx;
+    std::vector<RepoEntry> batch;        // parsed, not yet merged into g_repos
+    uint64_t               gen = 0;      // under mtx; stale jobs drop their output
+    std::atomic<bool>      running{false};
+    std::atomic<int>       filesDone{0};
+    std::atomic<int>       filesTotal{0};
+    std::shared_ptr<std::atomic<bool>> cancel;
+    std::string            doneMsg;      // main thread: status prefix once merged
+    std::string            keepKey;      // main thread: entry to reselect (F6)
+    int                    keepRow = 0;  // main thread: fallback row if it is gone
+};
+static RepoLoader g_loader;
+
+static void cancelRepoLoad() {
+    if (g_loader.cancel) g_loader.cancel->store(true);
+    std::lock_guard<std::mutex> lk(g_loader.mtx);
+    g_loader.gen++;
+    g_loader.batch.clear();
+    g_loader.running = false;
+    g_loader.doneMsg.clear();
+    g_loader.keepKey.clear();
+}
+
+static void loadReposAsync(const std::string& doneMsg) {
+    cancelRepoLoad();
+    g_repos.clear();
+    g_reposGen++;
     rebuildFiltered();
+
+    uint64_t gen;
+    {
+        std::lock_guard<std::mutex> lk(g_loader.mtx);
+        gen = g_loader.gen;
+    }
+    g_loader.doneMsg    = doneMsg;
+    g_loader.filesDone  = 0;
+    g_loader.filesTotal = 0;
+    g_loader.running    = true;
+    g_loader.cancel = g_sched.submit(JobClass::Interactive, [gen](JobCtx& ctx) {
+        auto files = repoSourceFiles();
+        g_loader.filesTotal = (int)files.size();
+        for (const auto& f : files) {
+            if (ctx.cancelled()) return;
+            std::vector<RepoEntry> out;
+            parseSourceFile(f, out);
+            std::lock_guard<std::mutex> lk(g_loader.mtx);
+            if (g_loader.gen != gen) return;
+            for (auto& e : out) g_loader.batch.push_back(std::move(e));
+            g_loader.filesDone++;
+            g_uiEpoch++;
+        }
+        std::lock_guard<std::mutex> lk(g_loader.mtx);
+        if (g_loader.gen == gen) g_loader.running = false;
+    });
+}
+
+// Main thread: append finished batches to g_repos.  Returns true if any
+// arrived; *finished is set once the last batch has been taken.
+static bool takeLoadedRepos(bool* finished) {
+    std::vector<RepoEntry> in;
+    {
+        std::lock_guard<std::mutex> lk(g_loader.mtx);
+        in.swap(g_loader.batch);
+        *finished = !g_loader.running && !g_loader.doneMsg.empty();
+    }
+    if (in.empty()) return false;
+    g_repos.reserve(g_repos.size() + in.size());
+    for (auto& e : in) g_repos.push_back(std::move(e));
+    g_reposGen++;
+    return true;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 8 — BACKUP
  * ═══════════════════════════════════════════════════════════════════════════ */
 
+// True if `name` is exactly `<base>.<YYYYMMDD_HHMMSS>.bak`.  A plain prefix
+// test would also claim sources.list.d/* backups for sources.list.
+static bool isBackupOf(const std::string& name, const std::string& base) {
+    const size_t tsLen = 15;
+    if (name.size() != base.size() + 1 + tsLen + 4) return false;
+    if (name.compare(0, base.size(), base) != 0 || name[base.size()] != '.') return false;
+    if (name.compare(name.size() - 4, 4, ".bak") != 0) return false;
+    const char* ts = name.c_str() + base.size() + 1;
+    for (size_t i = 0; i < tsLen; i++) {
+        bool ok = (i == 8) ? ts[i] == '_' : (ts[i] >= '0' && ts[i] <= '9');
+        if (!ok) return false;
+    }
+    return true;
+}
+
+// Delete all but the newest `keep` backups of one source file.  Runs as a
+// Maintenance job; backup names end in a sortable timestamp.  Opt-in:
+// backup_keep=0 (the default) never deletes anything.
+static void pruneBackupsAsync(const std::string& base) {
+    if (g_cfg.backupKeep <= 0) return;
+    std::string dir  = g_cfg.backupDir;
+    size_t      keep = (size_t)g_cfg.backupKeep;
+    g_sched.submit(JobClass::Maintenance, [dir, base, keep](JobCtx& ctx) {
+        std::error_code ec;
+        std::vector<std::string> mine;
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (isBackupOf(name, base))
+                mine.push_back(it->path().string());
+        }
+        if (mine.size() <= keep) return;
+        std::sort(mine.begin(), mine.end());
+        for (size_t i = 0; i + keep < mine.size(); i++) {
+            if (!ctx.yield()) return;
+            fs::remove(mine[i], ec);
+        }
+    });
+}
+
 static bool backupFile(const std::string& src, std::string& errMsg) {
     std::error_code ec;
     fs::create_directories(g_cfg.backupDir, ec);
@@ -488,6 +985,7 @@ static bool backupFile(const std::string& src, std::string& errMsg) {
 
     fs::copy_file(src, dest, fs::copy_options::overwrite_existing, ec);
     if (ec) { errMsg = "Backup copy failed: " + ec.message(); return false; }
+    pruneBackupsAsync(base);
     return true;
 }
 
@@ -523,25 +1021,86 @@ static bool atomicWriteLines(const std::string& path,
     return true;
 }
 
-// Call before any destructive write; saves old file state to undo stack
-static void pushUndo(const std::string& path) {
-    auto lines = readAllLines(path);
+// One file of a multi-file edit: its lines as read and as they should be
+struct FileWrite {
+    std::string              path;
+    std::vector<std::string> original, lines;
+};
+
+// Write every file; if one write fails, put the ones already written back
+// to their original lines.  `errMsg` says whether that worked.
+static bool writeAllOrNone(const std::vector<FileWrite>& files, std::string& errMsg) {
+    for (size_t i = 0; i < files.size(); i++) {
+        std::string we;
+        if (atomicWriteLines(files[i].path, files[i].lines, we)) continue;
+        errMsg = files[i].path + ": " + we;
+        bool restored = true;
+        for (size_t j = 0; j < i; j++) {
+            std::string re;
+            if (atomicWriteLines(files[j].path, files[j].original, re)) continue;
+            errMsg += "; could not restore " + files[j].path + ": " + re;
+            restored = false;
+        }
+        if (restored) errMsg += " (no file changed)";
+        return false;
+    }
+    return true;
+}
+
+// Record one undo step; a multi-file edit restores all its files at once
+static void pushUndoStep(std::vector<UndoFile> files) {
     if (g_undoStack.size() >= k_maxUndo) g_undoStack.erase(g_undoStack.begin());
-    g_undoStack.push_back({path, std::move(lines)});
+    g_undoStack.push_back({std::move(files)});
 }
 
+// Call before any destructive write; saves old file state to undo stack
+static void pushUndo(const std::string& path) { pushUndoStep({{path, readAllLines(path)}}); }
+
 static bool applyUndo(std::string& errMsg) {
     if (g_undoStack.empty()) { errMsg = "Nothing to undo."; return false; }
-    auto& u = g_undoStack.back();
-    if (!atomicWriteLines(u.file, u.lines, errMsg)) return false;
+    std::vector<FileWrite> step;
+    for (const auto& u : g_undoStack.back().files)
+        step.push_back({u.file, readAllLines(u.file), u.lines});
+    if (!writeAllOrNone(step, errMsg)) return false;
     g_undoStack.pop_back();
     return true;
 }
 
+// All or nothing: back up every file, then writeAllOrNone().  The edit
+// becomes a single undo step, pushed only once every write succeeded, so a
+// bulk edit of many files takes one slot of the undo stack.  Backup
+// warnings are appended to `notes`; they do not stop the edit.
+static bool writeFileSet(const std::vector<FileWrite>& files, std::vector<std::string>& notes,
+                         std::string& errMsg) {
+    for (const auto& f : files) {
+        std::string be;
+        if (!backupFile(f.path, be)) notes.push_back("[warn] backup skipped: " + be);
+    }
+    if (!writeAllOrNone(files, errMsg)) return false;
+    std::vector<UndoFile> undo;
+    for (const auto& f : files) undo.push_back({f.path, f.original});
+    if (!undo.empty()) pushUndoStep(std::move(undo));
+    return true;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 10 — TOGGLE LOGIC
  * ═══════════════════════════════════════════════════════════════════════════ */
 
+// [first, last] line of each deb822 stanza, in the same order as blockIndex
+struct LineRange { int s, e; };
+static std::vector<LineRange> deb822BlockRanges(const std::vector<std::string>& allLines) {
+    std::vector<LineRange> blocks;
+    int bs = -1; bool inB = false;
+    for (int i = 0; i < (int)allLines.size(); i++) {
+        bool blank = trimStr(allLines[i]).empty();
+        if (!blank && !inB) { bs = i; inB = true; }
+        if ( blank &&  inB) { blocks.push_back({bs, i-1}); inB = false; }
+    }
+    if (inB) blocks.push_back({bs, (int)allLines.size()-1});
+    return blocks;
+}
+
 static bool toggleList(const RepoEntry& repo, std::string& errMsg) {
     auto lines = readAllLines(repo.file);
     bool found = false;
@@ -597,6 +1156,58 @@ static bool toggleDeb822(const RepoEntry& repo, std::string& errMsg) {
     return atomicWriteLines(repo.file, allLines, errMsg);
 }
 
+// Disable many entries with one undo entry, backup and atomic write per
+// file.  A deb822 stanza is disabled only if every entry it yields is in
+// `repos`; the others are reported in `skipped`.
+static bool disableEntries(const std::vector<RepoEntry>& repos, int& filesWritten,
+                           std::vector<std::string>& skipped, std::string& errMsg) {
+    std::map<std::string, std::vector<const RepoEntry*>> byFile;
+    for (const auto& r : repos) if (r.enabled) byFile[r.file].push_back(&r);
+
+    filesWritten = 0;
+    for (const auto& kv : byFile) {
+        const std::string& file = kv.first;
+        auto allLines = readAllLines(file);
+        bool changed  = false;
+
+        if (!kv.second.front()->isDeb822) {
+            for (const RepoEntry* r : kv.second)
+                for (auto& l : allLines)
+                    if (l == r->display) { l = "# " + l; changed = true; break; }
+        } else {
+            std::map<int, int> wanted;                  // block → entries asked for
+            for (const RepoEntry* r : kv.second) wanted[r->blockIndex]++;
+            std::map<int, int> total;                   // block → entries it yields
+            for (const auto& r : g_repos)
+                if (r.file == file && r.enabled) total[r.blockIndex]++;
+            auto blocks = deb822BlockRanges(allLines);
+            for (auto it = wanted.rbegin(); it != wanted.rend(); ++it) {
+                if (it->first < 0 || it->first >= (int)blocks.size()) continue;
+                if (it->second < total[it->first]) {
+                    skipped.push_back(file + " stanza " + std::to_string(it->first) +
+                                      " (other URIs/suites in it are still used)");
+                    continue;
+                }
+                const LineRange& b = blocks[it->first];
+                int at = -1;
+                for (int i = b.s; i <= b.e; i++)
+                    if (trimStr(allLines[i]).rfind("Enabled:", 0) == 0) { at = i; break; }
+                if (at >= 0) allLines[at] = "Enabled: no";
+                else         allLines.insert(allLines.begin() + b.s + 1, "Enabled: no");
+                changed = true;
+            }
+        }
+        if (!changed) continue;
+
+        pushUndo(file);
+        std::string be;
+        if (!backupFile(file, be)) errMsg = "[warn] backup skipped: " + be;
+        if (!atomicWriteLines(file, allLines, errMsg)) return false;
+        filesWritten++;
+    }
+    return true;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 11 — DELETE LOGIC
  * ═══════════════════════════════════════════════════════════════════════════ */
@@ -690,6 +1301,178 @@ static bool importRepos(const std::string& path, std::string& errMsg) {
     return true;
 }
 
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 12A — BULK URI REWRITE (switch mirrors in one pass)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Rules are "FROM -> TO" prefix pairs.  A URI matches when it equals FROM or
+//  continues it with '/', so ".../ubuntu" never catches ".../ubuntu-ports";
+//  the first matching rule wins.  The plan rewrites .list lines (enabled or
+//  commented out) and deb822 URIs: fields, including their continuation
+//  lines, in place — only the URI tokens change — and keeps each file's
+//  original lines so apply can refuse a file that changed after the preview
+//  and put every file back if one write fails.
+
+struct UriRule {
+    std::string from, to;     // without trailing '/'
+};
+
+// "FROM TO" pairs; "->" between them and ';' or ',' between rules are optional
+static bool parseUriRules(const std::string& text, std::vector<UriRule>& rules, std::string& err) {
+    std::string flat = text;
+    std::replace(flat.begin(), flat.end(), ';', ' ');
+    std::replace(flat.begin(), flat.end(), ',', ' ');
+    std::vector<std::string> words;
+    for (const auto& w : splitWords(flat))
+        if (w != "->" && w != "=>") words.push_back(w);
+    if (words.empty() || words.size() % 2) { err = "Rules need FROM -> TO pairs."; return false; }
+    rules.clear();
+    for (size_t i = 0; i < words.size(); i += 2) {
+        UriRule r{ words[i], words[i + 1] };
+        while (!r.from.empty() && r.from.back() == '/') r.from.pop_back();
+        while (!r.to.empty()   && r.to.back()   == '/') r.to.pop_back();
+        if (r.from.find("://") == std::string::npos || r.to.find("://") == std::string::npos) {
+            err = "Not a URI: " + (r.from.find("://") == std::string::npos ? words[i] : words[i + 1]);
+            return false;
+        }
+        rules.push_back(std::move(r));
+    }
+    return true;
+}
+
+// `uri` under the first matching rule; false when none applies
+static bool rewriteUri(const std::string& uri, const std::vector<UriRule>& rules, std::string& out) {
+    for (const auto& r : rules) {
+        if (uri.compare(0, r.from.size(), r.from) != 0) continue;
+        if (uri.size() > r.from.size() && uri[r.from.size()] != '/') continue;
+        out = r.to + uri.substr(r.from.size());
+        return out != uri;
+    }
+    return false;
+}
+
+// Rewrite the whitespace-separated tokens of `line` from `pos` on (at most
+// `maxTokens`), keeping all spacing; returns the number of URIs changed
+static int rewriteTokens(std::string& line, size_t pos, const std::vector<UriRule>& rules, int maxTokens) {
+    int changed = 0;
+    for (int n = 0; n < maxTokens; n++) {
+        size_t b = line.find_first_not_of(" \t", pos);
+        if (b == std::string::npos || line[b] == '#') break;
+        size_t e = line.find_first_of(" \t", b);
+        if (e == std::string::npos) e = line.size();
+        std::string to;
+        if (rewriteUri(line.substr(b, e - b), rules, to)) {
+            line.replace(b, e - b, to);
+            e = b + to.size();
+            changed++;
+        }
+        pos = e;
+    }
+    return changed;
+}
+
+// One .list line: skip "# ", the type and any [options], rewrite the URI
+static int rewriteListLine(std::string& line, const std::vector<UriRule>& rules) {
+    size_t b = line.find_first_not_of(" \t#");
+    if (b == std::string::npos) return 0;
+    size_t p = line.find_first_of(" \t", b);
+    if (p == std::string::npos) return 0;
+    std::string type = line.substr(b, p - b);
+    if (type != "deb" && type != "deb-src") return 0;
+    size_t q = line.find_first_not_of(" \t", p);
+    if (q != std::string::npos && line[q] == '[') {
+        p = line.find(']', q);
+        if (p == std::string::npos) return 0;
+        p++;
+    }
+    return rewriteTokens(line, p, rules, 1);
+}
+
+struct RewriteChange {
+    int         line;              // 0-based
+    std::string before, after;
+};
+
+struct RewriteFile {
+    std::string                path;
+    std::vector<std::string>   original;
+    std::vector<std::string>   lines;      // rewritten content
+    std::vector<RewriteChange> changes;
+    int                        uris = 0;
+};
+
+static std::vector<RewriteFile> planUriRewrite(const std::vector<std::string>& files,
+                                               const std::vector<UriRule>& rules) {
+    std::vector<RewriteFile> plan;
+    for (const auto& path : files) {
+        RewriteFile f;
+        f.path     = path;
+        f.original = readAllLines(path);
+        f.lines    = f.original;
+        bool deb822 = path.size() > 8 && path.compare(path.size() - 8, 8, ".sources") == 0;
+        bool inUris = false;                  // deb822: inside a URIs: field
+        for (size_t i = 0; i < f.lines.size(); i++) {
+            std::string& l = f.lines[i];
+            int n = 0;
+            if (!deb822) n = rewriteListLine(l, rules);
+            else {
+                size_t p = l.find_first_not_of(" \t");
+                if (p == std::string::npos) { inUris = false; continue; }     // stanza ends
+                if (l[p] == '#') continue;
+                if (p > 0 && inUris) n = rewriteTokens(l, p, rules, INT_MAX); // continuation line
+                else {
+                    size_t colon = l.find(':', p);
+                    inUris = colon != std::string::npos && toLower(l.substr(p, colon - p)) == "uris";
+                    if (inUris) n = rewriteTokens(l, colon + 1, rules, INT_MAX);
+                }
+            }
+            if (n == 0) continue;
+            f.uris += n;
+            f.changes.push_back({ (int)i, f.original[i], l });
+        }
+        if (!f.changes.empty()) plan.push_back(std::move(f));
+    }
+    return plan;
+}
+
+// Unified-style preview: per file, each changed line as -/+ with its number
+static std::vector<std::string> rewritePreview(const std::vector<RewriteFile>& plan) {
+    std::vector<std::string> out;
+    for (const auto& f : plan) {
+        out.push_back("--- " + f.path + "  (" + std::to_string(f.uris) + " URI" + (f.uris == 1 ? "" : "s") + ")");
+        for (const auto& c : f.changes) {
+            std::string num = std::to_string(c.line + 1);
+            if (num.size() < 5) num.insert(0, 5 - num.size(), ' ');
+            out.push_back(num + " - " + c.before);
+            out.push_back("      + " + c.after);
+        }
+        out.push_back("");
+    }
+    return out;
+}
+
+// All files or none, through writeFileSet().  A file whose content moved on
+// since the preview is skipped; it and any backup warnings are reported in
+// `errMsg`.
+static bool applyUriRewrite(const std::vector<RewriteFile>& plan, int& filesWritten, std::string& errMsg) {
+    filesWritten = 0;
+    std::vector<FileWrite> todo;
+    std::vector<std::string> skipped, notes;
+    for (const auto& f : plan) {
+        if (readAllLines(f.path) != f.original) skipped.push_back(f.path);
+        else todo.push_back({ f.path, f.original, f.lines });
+    }
+    if (!writeFileSet(todo, notes, errMsg)) return false;
+    filesWritten = (int)todo.size();
+    if (!skipped.empty()) {
+        std::string s = "changed since preview, not rewritten:";
+        for (const auto& p : skipped) s += " " + p;
+        notes.push_back(s);
+    }
+    for (const auto& n : notes) errMsg += (errMsg.empty() ? "" : " ") + n;
+    return true;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 13 — REPO METADATA (async, non-blocking, 3 s timeout)
  * ═══════════════════════════════════════════════════════════════════════════ */
@@ -700,18 +1483,17 @@ struct RepoMeta {
     std::string suite;
     std::string version;
     std::string date;
+    std::string validUntil;
     std::string description;
     std::string lastUpdate; // from local apt cache mtime
     bool        reachable = false;
+    int         latencyMs = -1;     // probe round trip (HEAD or TCP connect)
     std::string error;
 };
 
 // Read apt cache Release file for this repo
-static RepoMeta metaFromCache(const RepoEntry& repo) {
-    RepoMeta m;
-    // apt cache: /var/lib/apt/lists/<host>_dists_<suite>_Release
-    if (repo.uri.empty() || repo.suite.empty()) return m;
-
+// apt's list-file prefix for an entry: /var/lib/apt/lists/<host_path>_dists_<suite>
+static std::string listsPrefix(const RepoEntry& repo) {
     // Derive cache prefix from URI
     // e.g. http://archive.ubuntu.com/ubuntu → archive.ubuntu.com_ubuntu
     std::string host = repo.uri;
@@ -726,7 +1508,49 @@ static RepoMeta metaFromCache(const RepoEntry& repo) {
     std::string suite = repo.suite;
     std::replace(suite.begin(), suite.end(), '/', '_');
 
-    std::string relPath = "/var/lib/apt/lists/" + host + "_dists_" + suite + "_Release";
+    return "/var/lib/apt/lists/" + host + "_dists_" + suite;
+}
+
+// Cached Release file for an entry; modern apt keeps only the signed InRelease
+static std::string cachedReleasePath(const RepoEntry& repo) {
+    std::string prefix = listsPrefix(repo);
+    if (fs::exists(prefix + "_InRelease")) return prefix + "_InRelease";
+    return prefix + "_Release";
+}
+
+// RFC 2822 date as used in Release files ("Sat, 09 Mar 2024 10:12:41 UTC",
+// also "+0000"-style offsets).  Parsed by hand: strptime's %a/%b follow
+// LC_TIME, which the UI sets from the environment.  -1 when unparsable.
+static int64_t parseReleaseDate(const std::string& s) {
+    static const char* const months[] = {"Jan","Feb","Mar","Apr","May","Jun",
+                                         "Jul","Aug","Sep","Oct","Nov","Dec"};
+    std::vector<std::string> w = splitWords(s);
+    if (!w.empty() && w[0].back() == ',') w.erase(w.begin());   // weekday
+    if (w.size() < 4) return -1;
+    struct tm tm{};
+    tm.tm_mon = -1;
+    for (int i = 0; i < 12; i++)
+        if (strncasecmp(w[1].c_str(), months[i], 3) == 0) tm.tm_mon = i;
+    int hh = 0, mm = 0, ss = 0;
+    if (tm.tm_mon < 0 || sscanf(w[3].c_str(), "%d:%d:%d", &hh, &mm, &ss) < 2) return -1;
+    tm.tm_mday = atoi(w[0].c_str());
+    tm.tm_year = atoi(w[2].c_str()) - 1900;
+    tm.tm_hour = hh; tm.tm_min = mm; tm.tm_sec = ss;
+    int64_t t = (int64_t)timegm(&tm);
+    if (w.size() > 4 && (w[4][0] == '+' || w[4][0] == '-') && w[4].size() == 5) {
+        int off = atoi(w[4].c_str() + 1);
+        int64_t secs = (off / 100) * 3600 + (off % 100) * 60;
+        t += w[4][0] == '+' ? -secs : secs;
+    }
+    return t;
+}
+
+static RepoMeta metaFromCache(const RepoEntry& repo) {
+    RepoMeta m;
+    // apt cache: /var/lib/apt/lists/<host>_dists_<suite>_{In,}Release
+    if (repo.uri.empty() || repo.suite.empty()) return m;
+
+    std::string relPath = cachedReleasePath(repo);
 
     // Check mtime for "last updated"
     struct stat st{};
@@ -746,16 +1570,15 @@ static RepoMeta metaFromCache(const RepoEntry& repo) {
         else if (line.rfind("Suite:",       0) == 0) m.suite       = trimStr(line.substr(6));
         else if (line.rfind("Version:",     0) == 0) m.version     = trimStr(line.substr(8));
         else if (line.rfind("Date:",        0) == 0) m.date        = trimStr(line.substr(5));
+        else if (line.rfind("Valid-Until:", 0) == 0) m.validUntil  = trimStr(line.substr(12));
         else if (line.rfind("Description:", 0) == 0) m.description = trimStr(line.substr(12));
     }
     return m;
 }
 
-// Non-blocking TCP reachability check with timeout_ms milliseconds
-static bool checkReachable(const std::string& uri, int timeout_ms = 3000) {
-    // Extract host and port from URI
-    std::string host;
-    std::string portStr = "80";
+// host and port of an http(s) URI ("80"/"443" unless given)
+static void uriHostPort(const std::string& uri, std::string& host, std::string& portStr) {
+    portStr = "80";
     auto spos = uri.find("://");
     host = (spos != std::string::npos) ? uri.substr(spos + 3) : uri;
     // check for https
@@ -766,122 +1589,4038 @@ static bool checkReachable(const std::string& uri, int timeout_ms = 3000) {
     // split host:port
     auto colon = host.rfind(':');
     if (colon != std::string::npos) { portStr = host.substr(colon + 1); host = host.substr(0, colon); }
+}
 
-    struct addrinfo hints{};
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    // getaddrinfo with timeout via separate thread
-    std::atomic<int> gai_ret{-1};
-    struct addrinfo* gai_res = nullptr;
-    std::mutex mtx; std::condition_variable cv; bool done = false;
-
-    std::thread([&]{
-        gai_ret = getaddrinfo(host.c_str(), portStr.c_str(), &hints, &gai_res);
-        std::lock_guard<std::mutex> lk(mtx);
-        done = true; cv.notify_one();
+// Non-blocking TCP connect with timeout_ms milliseconds; returns the
+// connected (non-blocking) socket or -1.  If `cancel` is given it is polled
+// while waiting; a cancelled attempt closes its socket immediately.
+static int connectWithTimeout(const std::string& host, const std::string& portStr, int timeout_ms,
+                              const std::atomic<bool>* cancel) {
+    auto isCancelled = [&]{ return cancel && cancel->load(); };
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    static constexpr int k_pollSliceMs = 50;
+
+    // getaddrinfo with timeout via separate thread. The resolver state is
+    // shared with the thread so an abandoned lookup (timeout / cancel) can
+    // finish later without touching this stack frame.
+    struct Resolve {
+        std::mutex              mtx;
+        std::condition_variable cv;
+        bool                    done    = false;
+        bool                    abandon = false;
+        int                     ret     = -1;
+        struct addrinfo*        res     = nullptr;
+    };
+    auto rs = std::make_shared<Resolve>();
+
+    std::thread([rs, host, portStr]{
+        struct addrinfo hints{};
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* res = nullptr;
+        int ret = getaddrinfo(host.c_str(), portStr.c_str(), &hints, &res);
+        std::lock_guard<std::mutex> lk(rs->mtx);
+        if (rs->abandon) { if (res) freeaddrinfo(res); return; }
+        rs->ret = ret; rs->res = res; rs->done = true;
+        rs->cv.notify_one();
     }).detach();
 
+    struct addrinfo* gai_res = nullptr;
     {
-        std::unique_lock<std::mutex> lk(mtx);
-        cv.wait_for(lk, std::chrono::milliseconds(timeout_ms), [&]{ return done; });
-        if (!done) return false; // DNS timeout
+        std::unique_lock<std::mutex> lk(rs->mtx);
+        while (!rs->done && !isCancelled() && std::chrono::steady_clock::now() < deadline)
+            rs->cv.wait_for(lk, std::chrono::milliseconds(k_pollSliceMs));
+        if (!rs->done) { rs->abandon = true; return -1; }    // DNS timeout / cancelled
+        if (rs->ret != 0 || !rs->res) return -1;
+        gai_res = rs->res;
     }
-    if (gai_ret != 0 || !gai_res) return false;
 
     int sock = socket(gai_res->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
-    if (sock < 0) { freeaddrinfo(gai_res); return false; }
+    if (sock < 0) { freeaddrinfo(gai_res); return -1; }
 
     ::connect(sock, gai_res->ai_addr, gai_res->ai_addrlen); // will EINPROGRESS
     freeaddrinfo(gai_res);
 
-    fd_set wfds; FD_ZERO(&wfds); FD_SET(sock, &wfds);
-    struct timeval tv{ timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
-    int sel = select(sock + 1, nullptr, &wfds, nullptr, &tv);
+    int sel = 0;
+    while (sel == 0 && !isCancelled()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) break;
+        int slice = (int)std::min<long long>(left, k_pollSliceMs);
+        fd_set wfds; FD_ZERO(&wfds); FD_SET(sock, &wfds);
+        struct timeval tv{ 0, slice * 1000 };
+        sel = select(sock + 1, nullptr, &wfds, nullptr, &tv);
+    }
+    bool ok = false;
+    if (sel == 1) {
+        int soErr = 0; socklen_t len = sizeof(soErr);
+        ok = getsockopt(sock, SOL_SOCKET, SO_ERROR, &soErr, &len) == 0 && soErr == 0;
+    }
+    if (!ok) { ::close(sock); return -1; }
+    return sock;
+}
+
+
+// TCP reachability check of an entry's host
+static bool checkReachable(const std::string& uri, int timeout_ms = 3000,
+                           const std::atomic<bool>* cancel = nullptr) {
+    std::string host, portStr;
+    uriHostPort(uri, host, portStr);
+    int sock = connectWithTimeout(host, portStr, timeout_ms, cancel);
+    if (sock < 0) return false;
     ::close(sock);
-    return sel == 1;
+    return true;
 }
 
-struct AsyncMeta {
-    std::mutex         mtx;
-    RepoMeta           meta;
-    std::atomic<bool>  ready{false};
-    std::atomic<bool>  running{false};
-    std::string        lastUri;  // which repo we fetched for
-};
-static AsyncMeta g_asyncMeta;
+/* ─── HTTP/1.1 client ───────────────────────────────────────────────────────
+ *
+ *  Blocking, one exchange at a time, on top of connectWithTimeout().  Bodies
+ *  by Content-Length, chunked or read-to-close; no TLS, so http:// only.
+ * ─────────────────────────────────────────────────────────────────────────── */
 
-static void fetchMetaAsync(const RepoEntry& repo) {
-    if (g_asyncMeta.running) return; // already in flight
-    g_asyncMeta.ready   = false;
-    g_asyncMeta.running = true;
-    g_asyncMeta.lastUri = repo.uri + repo.suite;
+struct HttpResponse {
+    int                                status    = 0;
+    std::map<std::string, std::string> headers;           // lower-case names
+    std::string                        body;
+    bool                               keepAlive = false;
 
-    // Capture by value so thread is safe after caller returns
-    RepoEntry r = repo;
-    std::thread([r]() {
-        RepoMeta m = metaFromCache(r);
-        m.reachable = checkReachable(r.uri, 3000);
-        std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
-        g_asyncMeta.meta    = m;
-        g_asyncMeta.ready   = true;
-        g_asyncMeta.running = false;
-    }).detach();
-}
+    std::string header(const std::string& name) const {
+        auto it = headers.find(name);
+        return it == headers.end() ? "" : it->second;
+    }
+};
 
-/* ═══════════════════════════════════════════════════════════════════════════
- *  SECTION 14 — UI STATE
- * ═══════════════════════════════════════════════════════════════════════════ */
+class HttpConnection {
+public:
+    HttpConnection(std::string host, std::string port)
+        : m_host(std::move(host)), m_port(std::move(port)) {}
+    ~HttpConnection() { close(); }
+    HttpConnection(const HttpConnection&)            = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+    // Receives the body piecewise instead of resp.body; returning false
+    // stops the transfer (the request then fails with "stopped")
+    using BodySink = std::function<bool(const char*, size_t)>;
+
+    // One request/response exchange.  Connects on demand; a reused
+    // connection the server has meanwhile closed is reopened once.
+    bool request(const std::string& method, const std::string& path,
+                 const std::vector<std::pair<std::string, std::string>>& headers,
+                 HttpResponse& resp, std::string& err, int timeoutMs = 5000,
+                 const std::atomic<bool>* cancel = nullptr, const BodySink& sink = nullptr) {
+        m_cancel   = cancel;
+        m_sink     = sink ? &sink : nullptr;
+        m_deadline = SteadyClock::now() + std::chrono::milliseconds(timeoutMs);
+        std::string req = method + " " + path + " HTTP/1.1\r\nHost: " + m_host +
+                          (m_port == "80" ? "" : ":" + m_port) + "\r\nUser-Agent: relix\r\n";
+        for (const auto& h : headers) req += h.first + ": " + h.second + "\r\n";
+        req += "\r\n";
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = m_fd >= 0;
+            if (!reused) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                m_deadline - SteadyClock::now()).count();
+                m_fd = left > 0 ? connectWithTimeout(m_host, m_port, (int)left, cancel) : -1;
+                if (m_fd < 0) { err = "connect failed"; return false; }
+                m_connects++;
+            }
+            bool gotAny = false;
+            resp = HttpResponse{};
+            if (exchange(req, method == "HEAD", resp, err, gotAny)) {
+                m_requests++;
+                if (!resp.keepAlive) close();
+                return true;
+            }
+            close();
+            if (!reused || gotAny || cancelled()) return false;    // only a stale reuse is retried
+        }
+        return false;
+    }
 
-static int         g_selected    = 0;
-static int         g_scrollOff   = 0;
-static std::string g_status;
-static bool        g_statusErr   = false;
-static bool        g_searchMode  = false;
-static RepoMeta    g_curMeta;
-static bool        g_metaShown   = false;
+    const std::string& host() const { return m_host; }
+    const std::string& port() const { return m_port; }
+    int connects() const { return m_connects; }
+    int requests() const { return m_requests; }
+
+    // Still usable for another request: open, and the server has neither
+    // closed it nor sent anything unsolicited while it sat idle
+    bool alive() {
+        if (m_fd < 0 || m_pos < m_buf.size()) return false;
+        struct pollfd pfd{ m_fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 0) == 0) return true;
+        char c;
+        if (::recv(m_fd, &c, 1, MSG_PEEK) > 0) return false;
+        close();
+        return false;
+    }
 
-static void setStatus(const std::string& msg, bool isErr = false) {
-    g_status    = msg;
-    g_statusErr = isErr;
-}
+private:
+    static constexpr size_t k_maxBody    = 8u << 20;
+    static constexpr int    k_pollSliceMs = 50;
 
-static void clampSelection() {
-    int sz = (int)g_filtered.size();
-    if (sz == 0) { g_selected = 0; g_scrollOff = 0; return; }
-    g_selected = std::max(0, std::min(g_selected, sz - 1));
-    int listH  = LINES - 5;
-    if (listH < 1) listH = 1;
-    if (g_scrollOff > g_selected)              g_scrollOff = g_selected;
-    if (g_selected >= g_scrollOff + listH)     g_scrollOff = g_selected - listH + 1;
-    g_scrollOff = std::max(0, g_scrollOff);
-}
+    bool cancelled() const { return m_cancel && m_cancel->load(); }
 
-// Handy accessor: index into g_repos for the currently selected filtered entry
-static int currentRepoIndex() {
-    if (g_filtered.empty()) return -1;
+    void close() {
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+        m_buf.clear();
+        m_pos = 0;
+    }
+
+    // Wait for `events` in 50 ms slices until the deadline or cancel
+    bool waitFor(short events) {
+        while (!cancelled()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            m_deadline - SteadyClock::now()).count();
+            if (left <= 0) return false;
+            struct pollfd pfd{ m_fd, events, 0 };
+            int n = ::poll(&pfd, 1, (int)std::min<long long>(left, k_pollSliceMs));
+            if (n > 0) return true;
+            if (n < 0 && errno != EINTR) return false;
+        }
+        return false;
+    }
+
+    bool sendAll(const std::string& data) {
+        size_t off = 0;
+        while (off < data.size()) {
+            ssize_t n = ::send(m_fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+            if (n > 0) { off += (size_t)n; continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) { if (!waitFor(POLLOUT)) return false; continue; }
+            return false;
+        }
+        return true;
+    }
+
+    // Append what the socket has to m_buf; false on EOF, error or timeout
+    bool fill() {
+        if (m_pos > 0 && m_pos == m_buf.size()) { m_buf.clear(); m_pos = 0; }
+        char tmp[16384];
+        for (;;) {
+            ssize_t n = ::recv(m_fd, tmp, sizeof(tmp), 0);
+            if (n > 0) { m_buf.append(tmp, (size_t)n); return true; }
+            if (n == 0) return false;
+            if (errno != EAGAIN && errno != EINTR) return false;
+            if (!waitFor(POLLIN)) return false;
+        }
+    }
+
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t nl = m_buf.find('\n', m_pos);
+            if (nl != std::string::npos) {
+                line.assign(m_buf, m_pos, nl - m_pos);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                m_pos = nl + 1;
+                return true;
+            }
+            if (m_buf.size() - m_pos > 65536 || !fill()) return false;
+        }
+    }
+
+    bool deliver(const char* p, size_t n, HttpResponse& resp, std::string& err) {
+        if (m_sink) {
+            if ((*m_sink)(p, n)) return true;
+            err = "stopped";
+            return false;
+        }
+        if (resp.body.size() + n > k_maxBody) { err = "response too large"; return false; }
+        resp.body.append(p, n);
+        return true;
+    }
+
+    bool readBody(size_t n, HttpResponse& resp, std::string& err) {
+        while (n > 0) {
+            if (m_pos == m_buf.size() && !fill()) { err = "truncated body"; return false; }
+            size_t take = std::min(n, m_buf.size() - m_pos);
+            if (!deliver(m_buf.data() + m_pos, take, resp, err)) return false;
+            m_pos += take;
+            n     -= take;
+        }
+        return true;
+    }
+
+    bool exchange(const std::string& req, bool head, HttpResponse& resp, std::string& err, bool& gotAny) {
+        if (!sendAll(req)) { err = "send failed"; return false; }
+        std::string line;
+        do {                                                     // skip 1xx interim responses
+            if (!readLine(line)) { err = cancelled() ? "cancelled" : "no response"; return false; }
+            gotAny = true;
+            if (line.rfind("HTTP/1.", 0) != 0 || line.size() < 12) { err = "not an HTTP response"; return false; }
+            resp.status = atoi(line.c_str() + 9);
+            bool http11 = line[7] == '1';
+            resp.headers.clear();
+            for (;;) {
+                if (!readLine(line)) { err = "truncated headers"; return false; }
+                if (line.empty()) break;
+                auto colon = line.find(':');
+                if (colon == std::string::npos) continue;
+                std::string name = line.substr(0, colon);
+                for (auto& c : name) c = (char)tolower((unsigned char)c);
+                std::string value = trimStr(line.substr(colon + 1));
+                auto& slot = resp.headers[name];
+                slot = slot.empty() ? value : slot + ", " + value;
+            }
+            std::string conn = resp.header("connection");
+            for (auto& c : conn) c = (char)tolower((unsigned char)c);
+            resp.keepAlive = http11 ? conn.find("close") == std::string::npos
+                                    : conn.find("keep-alive") != std::string::npos;
+        } while (resp.status >= 100 && resp.status < 200);
+
+        if (head || resp.status == 204 || resp.status == 304) return true;
+        std::string te = resp.header("transfer-encoding");
+        for (auto& c : te) c = (char)tolower((unsigned char)c);
+        if (te.find("chunked") != std::string::npos) {
+            for (;;) {
+                if (!readLine(line)) { err = "truncated chunk"; return false; }
+                size_t n = strtoul(line.c_str(), nullptr, 16);
+                if (n == 0) break;
+                if (!readBody(n, resp, err)) return false;
+                if (!readLine(line)) { err = "truncated chunk"; return false; }
+            }
+            do { if (!readLine(line)) { err = "truncated trailer"; return false; } } while (!line.empty());
+            return true;
+        }
+        std::string cl = resp.header("content-length");
+        if (!cl.empty()) {
+            return readBody(strtoull(cl.c_str(), nullptr, 10), resp, err);
+        }
+        resp.keepAlive = false;                                  // body runs to EOF
+        for (;;) {
+            if (!deliver(m_buf.data() + m_pos, m_buf.size() - m_pos, resp, err)) return false;
+            m_pos = m_buf.size();
+            if (!fill()) break;
+        }
+        if (cancelled()) { err = "cancelled"; return false; }
+        return true;
+    }
+
+    std::string              m_host, m_port;
+    int                      m_fd       = -1;
+    std::string              m_buf;
+    size_t                   m_pos      = 0;
+    int                      m_connects = 0;
+    int                      m_requests = 0;
+    const std::atomic<bool>* m_cancel   = nullptr;
+    const BodySink*          m_sink     = nullptr;
+    SteadyClock::time_point  m_deadline;
+};
+
+// IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"), built by hand: strftime's
+// names follow LC_TIME
+static std::string httpDate(int64_t t) {
+    static const char* const days[]   = {"Sun","Mon","Tue","Wed","Thu","Fri","Sat"};
+    static const char* const months[] = {"Jan","Feb","Mar","Apr","May","Jun",
+                                         "Jul","Aug","Sep","Oct","Nov","Dec"};
+    time_t tt = (time_t)t;
+    struct tm tm{};
+    gmtime_r(&tt, &tm);
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT", days[tm.tm_wday], tm.tm_mday,
+             months[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return buf;
+}
+
+/* ─── keep-alive connection pool ────────────────────────────────────────────
+ *
+ *  Connections are leased per "host:port" and returned to an idle list when
+ *  the server kept them open, so every probe of a host after the first skips
+ *  DNS and the TCP handshake.  At most k_perHost connections per host and
+ *  k_global overall (busy + idle) exist; acquire() waits for a slot, evicting
+ *  another host's oldest idle connection when the global cap is reached.
+ *  Idle connections are dropped after 15 s — servers close them anyway.
+ * ─────────────────────────────────────────────────────────────────────────── */
+
+class HttpPool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(HttpPool* pool, std::string key, std::unique_ptr<HttpConnection> conn)
+            : m_pool(pool), m_key(std::move(key)), m_conn(std::move(conn)),
+              m_base(m_conn->connects()) {}
+        Lease(Lease&& o) noexcept = default;
+        Lease& operator=(Lease&& o) noexcept {
+            if (this != &o) { giveBack(); m_pool = o.m_pool; m_key = std::move(o.m_key);
+                              m_conn = std::move(o.m_conn); m_base = o.m_base; }
+            return *this;
+        }
+        ~Lease() { giveBack(); }
+
+        explicit operator bool() const { return m_conn != nullptr; }
+        HttpConnection* operator->() const { return m_conn.get(); }
+        HttpConnection& operator*()  const { return *m_conn; }
+
+    private:
+        void giveBack() { if (m_conn) m_pool->release(m_key, std::move(m_conn), m_base); }
+        HttpPool*                       m_pool = nullptr;
+        std::string                     m_key;
+        std::unique_ptr<HttpConnection> m_conn;
+        int                             m_base = 0;    // connects() when leased
+    };
+
+    // Empty lease on cancel or when no slot frees up within timeout_ms
+    Lease acquire(const std::string& host, const std::string& port,
+                  const std::atomic<bool>* cancel = nullptr, int timeout_ms = 5000) {
+        const std::string key = host + ":" + port;
+        auto deadline = SteadyClock::now() + std::chrono::milliseconds(timeout_ms);
+        std::unique_lock<std::mutex> lk(m_mtx);
+        for (;;) {
+            pruneIdle(SteadyClock::now());
+            auto& idle = m_idle[key];
+            while (!idle.empty()) {
+                Idle it = std::move(idle.back());
+                idle.pop_back();
+                if (it.conn->alive()) {
+                    m_busy[key]++;
+                    m_reused++;
+                    return Lease(this, key, std::move(it.conn));
+                }
+                m_open--;
+            }
+            if (m_busy[key] < k_perHost) {
+                if (m_open >= k_global) evictOldestIdle();
+                if (m_open < k_global) {
+                    m_busy[key]++;
+                    m_open++;
+                    return Lease(this, key, std::make_unique<HttpConnection>(host, port));
+                }
+            }
+            if ((cancel && cancel->load()) || SteadyClock::now() >= deadline) return Lease();
+            m_cv.wait_for(lk, std::chrono::milliseconds(50));
+        }
+    }
+
+    int opened() const { return m_opened; }     // TCP connections made so far
+    int reused() const { return m_reused; }     // leases served from the idle list
+
+private:
+    static constexpr int k_perHost = 2;
+    static constexpr int k_global  = 8;
+    static constexpr int k_idleSec = 15;
+
+    struct Idle {
+        std::unique_ptr<HttpConnection> conn;
+        SteadyClock::time_point         since;
+    };
+
+    void release(const std::string& key, std::unique_ptr<HttpConnection> conn, int base) {
+        std::lock_guard<std::mutex> lk(m_mtx);
+        m_opened += conn->connects() - base;
+        m_busy[key]--;
+        if (conn->alive()) m_idle[key].push_back({ std::move(conn), SteadyClock::now() });
+        else               m_open--;
+        m_cv.notify_all();
+    }
+
+    void pruneIdle(SteadyClock::time_point now) {
+        for (auto& kv : m_idle)
+            for (auto it = kv.second.begin(); it != kv.second.end(); )
+                if (now - it->since > std::chrono::seconds(k_idleSec)) { it = kv.second.erase(it); m_open--; }
+                else ++it;
+    }
+
+    void evictOldestIdle() {
+        std::vector<Idle>* from = nullptr;
+        for (auto& kv : m_idle)
+            if (!kv.second.empty() && (!from || kv.second.front().since < from->front().since))
+                from = &kv.second;
+        if (!from) return;
+        from->erase(from->begin());
+        m_open--;
+    }
+
+    std::mutex                               m_mtx;
+    std::condition_variable                  m_cv;
+    std::map<std::string, std::vector<Idle>> m_idle;     // oldest first
+    std::map<std::string, int>               m_busy;
+    int                                      m_open   = 0;
+    std::atomic<int>                         m_opened{0};
+    std::atomic<int>                         m_reused{0};
+};
+static HttpPool g_httpPool;
+
+// request() that follows 3xx answers the way apt does, up to 5 hops, with
+// the same headers.  The first hop goes over `conn`; a hop to another http
+// host leases from the pool.  A redirect that cannot be followed here (to
+// https://) comes back as the 3xx itself with `moved` set to its Location,
+// so callers can say "moved" rather than "failed".
+// `path` ends as the path that produced `resp`.
+static bool requestFollowing(HttpConnection& conn, const std::string& method, std::string& path,
+                             const std::vector<std::pair<std::string, std::string>>& headers,
+                             HttpResponse& resp, std::string& err, std::string& moved,
+                             int timeoutMs = 5000, const std::atomic<bool>* cancel = nullptr) {
+    moved.clear();
+    HttpConnection* c = &conn;
+    HttpPool::Lease hop;
+    for (int n = 0; ; n++) {
+        if (!c->request(method, path, headers, resp, err, timeoutMs, cancel)) return false;
+        if (resp.status < 300 || resp.status > 399 || resp.status == 304) return true;
+        std::string loc = trimStr(resp.header("location"));
+        if (loc.empty()) return true;
+        std::string host = c->host(), port = c->port(), next;
+        if (loc.rfind("http://", 0) == 0) {
+            uriHostPort(loc, host, port);
+            auto slash = loc.find('/', 7);
+            next = slash == std::string::npos ? "/" : loc.substr(slash);
+        } else if (loc.find("://") != std::string::npos) {
+            moved = loc;                                   // https:// etc.: http only here
+            return true;
+        } else if (loc[0] == '/') {
+            next = loc;
+        } else {
+            next = path.substr(0, path.rfind('/') + 1) + loc;
+        }
+        if (n == 4) { err = "too many redirects"; return false; }
+        path = next;
+        if (host != c->host() || port != c->port()) {
+            hop = g_httpPool.acquire(host, port, cancel);
+            if (!hop) { err = "redirected to " + host + ", no free connection slot"; return false; }
+            c = &*hop;
+        }
+    }
+}
+
+// Reachability plus round-trip time.  http:// sources get a HEAD of the
+// repository root over a pooled connection (any HTTP answer counts); other
+// schemes fall back to a bare TCP connect.
+static bool probeRepo(const std::string& uri, int& latencyMs, int timeout_ms = 3000,
+                      const std::atomic<bool>* cancel = nullptr) {
+    latencyMs = -1;
+    auto t0 = SteadyClock::now();
+    auto elapsed = [&] {
+        return (int)std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::now() - t0).count();
+    };
+    if (uri.rfind("http://", 0) != 0) {
+        if (!checkReachable(uri, timeout_ms, cancel)) return false;
+        latencyMs = elapsed();
+        return true;
+    }
+    std::string host, port;
+    uriHostPort(uri, host, port);
+    auto conn = g_httpPool.acquire(host, port, cancel, timeout_ms);
+    if (!conn) return false;
+    std::string path = uri.substr(7);
+    auto slash = path.find('/');
+    path = slash == std::string::npos ? "/" : path.substr(slash);
+    if (path.back() != '/') path += '/';
+    t0 = SteadyClock::now();                      // time the exchange, not the wait for a slot
+    HttpResponse resp;
+    std::string err;
+    if (!conn->request("HEAD", path, {}, resp, err, timeout_ms, cancel)) return false;
+    latencyMs = elapsed();
+    return true;
+}
+
+/* ─── generation-tagged async fetch ──────────────────────────────────────────
+ *
+ *  Every request bumps `generation` and records the key of the entry it was
+ *  issued for.  A worker only publishes its result if its ticket is still the
+ *  current generation; stale results go into `cache` so revisiting the entry
+ *  shows them instantly.  Issuing a new request cancels the previous probe.
+ * ─────────────────────────────────────────────────────────────────────────── */
+
+static std::string metaKey(const RepoEntry& r) { return r.uri + " " + r.suite; }
+
+struct AsyncMeta {
+    std::mutex                          mtx;
+    RepoMeta                            meta;       // result of the current ticket
+    std::string                         resultKey;  // which repo `meta` belongs to
+    std::atomic<bool>                   ready{false};
+    std::atomic<bool>                   running{false}; // current ticket in flight
+    std::atomic<uint64_t>               generation{0};
+    std::string                         wantKey;    // key of the current ticket
+    std::shared_ptr<std::atomic<bool>>  cancel;     // cancel flag of current probe
+    std::map<std::string, RepoMeta>     cache;      // completed results by key
+};
+static AsyncMeta g_asyncMeta;
+
+static void fetchMetaAsync(const RepoEntry& repo) {
+    std::string key = metaKey(repo);
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+        if (g_asyncMeta.running && g_asyncMeta.wantKey == key) return; // already in flight
+        if (g_asyncMeta.cancel) g_asyncMeta.cancel->store(true);       // supersede old probe
+        ticket = ++g_asyncMeta.generation;
+        g_asyncMeta.wantKey = key;
+        g_asyncMeta.cancel  = cancel;
+        g_asyncMeta.ready   = false;
+        g_asyncMeta.running = true;
+    }
+
+    // Capture by value so the job is safe after caller returns
+    RepoEntry r = repo;
+    g_sched.submit(JobClass::Interactive, [r, key, ticket](JobCtx& ctx) {
+        RepoMeta m = metaFromCache(r);
+        m.reachable = probeRepo(r.uri, m.latencyMs, 3000, ctx.cancel.get());
+        std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+        bool current = (ticket == g_asyncMeta.generation.load());
+        if (ctx.cancelled()) {
+            if (current) g_asyncMeta.running = false;
+            return; // superseded — probe result is meaningless
+        }
+        g_asyncMeta.cache[key] = m;
+        if (!current) return; // stale ticket: cached only, never displayed
+        g_asyncMeta.meta      = m;
+        g_asyncMeta.resultKey = key;
+        g_asyncMeta.ready     = true;
+        g_asyncMeta.running   = false;
+    }, SteadyClock::time_point::max(), cancel);
+}
+
+// Warm the cache for entries near the selection at Prefetch priority.  The
+// previous round is cancelled; jobs not started within 5 s are dropped.
+static void prefetchMeta(const std::vector<RepoEntry>& repos) {
+    g_sched.cancelClass(JobClass::Prefetch);
+    auto deadline = SteadyClock::now() + std::chrono::seconds(5);
+    for (const auto& repo : repos) {
+        std::string key = metaKey(repo);
+        {
+            std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+            if (g_asyncMeta.cache.count(key)) continue;
+        }
+        RepoEntry r = repo;
+        g_sched.submit(JobClass::Prefetch, [r, key](JobCtx& ctx) {
+            if (!ctx.yield()) return;
+            RepoMeta m = metaFromCache(r);
+            m.reachable = probeRepo(r.uri, m.latencyMs, 3000, ctx.cancel.get());
+            if (ctx.cancelled()) return;
+            std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+            g_asyncMeta.cache.emplace(key, m);
+        }, deadline);
+    }
+}
+
+/* ─── bulk reachability ─────────────────────────────────────────────────── */
+
+struct BulkProbe {
+    std::atomic<bool> running{false};
+    std::atomic<int>  gen{0};
+    std::atomic<int>  done{0};
+    std::atomic<int>  total{0};
+    std::atomic<int>  unreachable{0};
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+static BulkProbe g_bulkProbe;
+
+// Probe every repo (one probe per host, pooled) as a single Bulk job; results land
+// in the metadata cache so the detail pane shows them on selection.
+static void probeAllAsync(const std::vector<RepoEntry>& repos) {
+    if (g_bulkProbe.cancel) g_bulkProbe.cancel->store(true);
+    g_bulkProbe.done        = 0;
+    g_bulkProbe.unreachable = 0;
+    g_bulkProbe.total       = (int)repos.size();
+    g_bulkProbe.running     = true;
+    int gen = ++g_bulkProbe.gen;
+    g_bulkProbe.cancel = g_sched.submit(JobClass::Bulk, [repos, gen](JobCtx& ctx) {
+        std::map<std::string, std::pair<bool, int>> byHost;    // reachable, latency
+        for (const auto& r : repos) {
+            if (!ctx.yield()) break;
+            std::string host = r.uri;
+            auto sp = host.find("://");
+            if (sp != std::string::npos) host = host.substr(sp + 3);
+            host = host.substr(0, host.find('/'));
+            RepoMeta m = metaFromCache(r);
+            auto hit = byHost.find(host);
+            if (hit != byHost.end()) std::tie(m.reachable, m.latencyMs) = hit->second;
+            else {
+                m.reachable = probeRepo(r.uri, m.latencyMs, 3000, ctx.cancel.get());
+                byHost[host] = { m.reachable, m.latencyMs };
+            }
+            if (ctx.cancelled()) break;
+            if (!m.reachable) g_bulkProbe.unreachable++;
+            {
+                std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+                g_asyncMeta.cache[metaKey(r)] = m;
+            }
+            g_bulkProbe.done++;
+            g_uiEpoch++;
+        }
+        if (g_bulkProbe.gen == gen) g_bulkProbe.running = false;
+    });
+}
+
+static void dropCachedMeta(const RepoEntry& r) {
+    std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+    g_asyncMeta.cache.erase(metaKey(r));
+}
+
+// Cached result for `r` from an earlier (possibly stale) ticket
+static bool cachedMeta(const RepoEntry& r, RepoMeta& out) {
+    std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+    auto it = g_asyncMeta.cache.find(metaKey(r));
+    if (it == g_asyncMeta.cache.end()) return false;
+    out = it->second;
+    return true;
+}
+
+// True if the in-flight ticket belongs to `r`
+static bool metaPendingFor(const RepoEntry& r) {
+    if (!g_asyncMeta.running) return false;
+    std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+    return g_asyncMeta.wantKey == metaKey(r);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13A — UPDATE COST ESTIMATOR
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Predicts what `apt update` downloads for each enabled entry from the
+//  SHA256 table of its cached InRelease.  Every index target APT is
+//  configured to fetch (Acquire::IndexTargets) is expanded over the entry's
+//  components × architectures (× languages) and priced at the first
+//  compression APT would pick.  A target whose local list already has the
+//  size the Release lists for it counts as current and costs nothing; the
+//  InRelease itself is always fetched.  pdiffs are not modelled.
+
+struct UpdateCost {
+    bool     known   = false;   // false: no cached Release to estimate from
+    uint64_t bytes   = 0;       // predicted download
+    int      files   = 0;       // files to fetch, InRelease included
+    int      current = 0;       // index targets already up to date locally
+    uint64_t listedBytes = 0;   // full download of every target, current or not
+};
+
+struct IndexTargetSpec {
+    std::string type;           // "deb" / "deb-src"
+    std::string metaKey;        // e.g. "$(COMPONENT)/binary-$(ARCHITECTURE)/Packages"
+};
+
+// Index targets enabled in APT's configuration, plus the languages it fetches
+static void aptIndexConfig(std::vector<IndexTargetSpec>& targets, std::vector<std::string>& langs) {
+    std::map<std::string, IndexTargetSpec> byName;
+    std::set<std::string> disabled;
+    for (const auto& l : commandLines("apt-config dump 2>/dev/null")) {
+        auto q1 = l.find('"'), q2 = l.rfind('"');
+        if (q1 == std::string::npos || q2 <= q1) continue;
+        std::string key = l.substr(0, l.find(' ')), val = l.substr(q1 + 1, q2 - q1 - 1);
+        if (key == "Acquire::Languages::") {
+            if (val == "environment") {
+                const char* env = getenv("LANG");
+                std::string ll = env ? env : "";
+                ll = ll.substr(0, ll.find_first_of("_.@"));
+                if (ll.empty() || ll == "C" || ll == "POSIX") continue;
+                val = ll;
+            }
+            if (std::find(langs.begin(), langs.end(), val) == langs.end()) langs.push_back(val);
+            continue;
+        }
+        static const std::string pfx = "Acquire::IndexTargets::";
+        if (key.rfind(pfx, 0) != 0) continue;
+        // <type>::<name>::<field>
+        std::string rest = key.substr(pfx.size());
+        auto a = rest.find("::"), b = rest.rfind("::");
+        if (a == std::string::npos || a == b) continue;
+        std::string type = rest.substr(0, a), name = rest.substr(0, b), field = rest.substr(b + 2);
+        if (field == "MetaKey")                              byName[name] = {type, val};
+        else if (field == "DefaultEnabled" && val == "false") disabled.insert(name);
+    }
+    for (auto& kv : byName)
+        if (!disabled.count(kv.first)) targets.push_back(kv.second);
+    if (targets.empty())   // apt-config unavailable: APT's built-in defaults
+        targets = {{"deb",     "$(COMPONENT)/binary-$(ARCHITECTURE)/Packages"},
+                   {"deb",     "$(COMPONENT)/i18n/Translation-$(LANGUAGE)"},
+                   {"deb-src", "$(COMPONENT)/source/Sources"}};
+    if (std::find(langs.begin(), langs.end(), "none") != langs.end()) langs.clear();
+    else if (std::find(langs.begin(), langs.end(), "en") == langs.end()) langs.push_back("en");
+}
+
+// SHA256 table of a cached (In)Release: path → size, plus its Architectures:
+struct ReleaseIndex {
+    std::map<std::string, uint64_t> sizes;
+    std::vector<std::string>        archs;
+    uint64_t                        selfSize = 0;
+};
+
+static bool readReleaseIndex(const std::string& path, ReleaseIndex& out) {
+    std::ifstream f(path);
+    if (!f.is_open()) return false;
+    struct stat st{};
+    if (::stat(path.c_str(), &st) == 0) out.selfSize = (uint64_t)st.st_size;
+    std::string line;
+    bool inSha = false;
+    while (std::getline(f, line)) {
+        if (!line.empty() && line[0] == ' ') {
+            if (!inSha) continue;
+            auto w = splitWords(line);
+            if (w.size() == 3) out.sizes[w[2]] = std::strtoull(w[1].c_str(), nullptr, 10);
+            continue;
+        }
+        inSha = (line.rfind("SHA256:", 0) == 0);
+        if (line.rfind("Architectures:", 0) == 0) out.archs = splitWords(line.substr(14));
+    }
+    return true;
+}
+
+static std::string expandMetaKey(std::string k, const std::string& comp,
+                                 const std::string& arch, const std::string& lang) {
+    auto sub = [&k](const std::string& var, const std::string& val) {
+        for (size_t p; (p = k.find(var)) != std::string::npos; ) k.replace(p, var.size(), val);
+    };
+    sub("$(COMPONENT)", comp);
+    sub("$(ARCHITECTURE)", arch);
+    sub("$(NATIVE_ARCHITECTURE)", systemArchitectures()[0]);
+    sub("$(LANGUAGE)", lang);
+    return k;
+}
+
+static bool fileHasSize(const std::string& path, uint64_t size) {
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0 && (uint64_t)st.st_size == size;
+}
+
+// Cost of one entry.  `seen` holds list files already priced by earlier
+// entries so that shared indexes count once in the total; pass null to
+// price the entry on its own.
+static UpdateCost estimateUpdateCost(const RepoEntry& r,
+                                     const std::vector<IndexTargetSpec>& targets,
+                                     const std::vector<std::string>& langs,
+                                     std::set<std::string>* seen) {
+    UpdateCost c;
+    if (r.uri.empty() || r.suite.empty() || r.suite.back() == '/') return c;   // flat repos
+    ReleaseIndex rel;
+    if (!readReleaseIndex(cachedReleasePath(r), rel)) return c;
+    c.known = true;
+
+    const std::string prefix = listsPrefix(r);
+    if (!seen || seen->insert(prefix).second) {
+        c.bytes += rel.selfSize; c.listedBytes += rel.selfSize; c.files++;
+    }
+
+    std::vector<std::string> archs = r.archs.empty() ? systemArchitectures() : splitWords(r.archs);
+    if (std::find(rel.archs.begin(), rel.archs.end(), "all") != rel.archs.end() &&
+        std::find(archs.begin(), archs.end(), "all") == archs.end())
+        archs.push_back("all");
+    const std::vector<std::string> types  = splitWords(r.types);
+    const std::vector<std::string> single = {""};   // loop once, variable unused
+    static const char* exts[] = {".xz", ".bz2", ".lzma", ".gz", ".lz4", ".zst", ""};
+
+    for (const auto& t : targets) {
+        if (std::find(types.begin(), types.end(), t.type) == types.end()) continue;
+        bool perArch = t.metaKey.find("$(ARCHITECTURE)") != std::string::npos;
+        bool perLang = t.metaKey.find("$(LANGUAGE)")     != std::string::npos;
+        for (const auto& comp : splitWords(r.components))
+            for (const auto& arch : perArch ? archs : single)
+                for (const auto& lang : perLang ? langs : single) {
+                    std::string path = expandMetaKey(t.metaKey, comp, arch, lang);
+                    std::string local = path;
+                    std::replace(local.begin(), local.end(), '/', '_');
+                    local = prefix + "_" + local;
+                    if (seen && !seen->insert(local).second) continue;
+
+                    // First compression the archive offers, in APT's order
+                    const char* pick = nullptr;
+                    for (const char* e : exts)
+                        if (rel.sizes.count(path + e)) { pick = e; break; }
+                    if (!pick) continue;              // not published for this combo
+                    c.listedBytes += rel.sizes[path + pick];
+
+                    bool current = false;
+                    for (const char* e : exts) {
+                        auto it = rel.sizes.find(path + e);
+                        if (it != rel.sizes.end() && fileHasSize(local + e, it->second)) { current = true; break; }
+                    }
+                    if (current) { c.current++; continue; }
+                    c.bytes += rel.sizes[path + pick];
+                    c.files++;
+                }
+    }
+    return c;
+}
+
+static std::string costKey(const RepoEntry& r) {
+    return r.types + " " + r.uri + " " + r.suite + " " + r.components + " [" + r.archs + "]";
+}
+
+struct CostTable {
+    std::mutex                        mtx;
+    std::map<std::string, UpdateCost> byKey;    // costKey() → estimate
+    UpdateCost                        total;    // enabled entries, shared indexes once
+    bool                              ready = false;
+    uint64_t                          reposGen = 0;   // main thread: g_reposGen estimated
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+static CostTable g_costs;
+
+// One background pass over the enabled entries
+static void estimateCostsAsync(const std::vector<RepoEntry>& repos) {
+    if (g_costs.cancel) g_costs.cancel->store(true);
+    g_costs.reposGen = g_reposGen;
+    std::vector<RepoEntry> enabled;
+    for (const auto& r : repos) if (r.enabled) enabled.push_back(r);
+    g_costs.cancel = g_sched.submit(JobClass::Bulk, [enabled](JobCtx& ctx) {
+        std::vector<IndexTargetSpec> targets;
+        std::vector<std::string>     langs;
+        aptIndexConfig(targets, langs);
+        std::map<std::string, UpdateCost> byKey;
+        std::set<std::string> seen;
+        UpdateCost total;
+        for (const auto& r : enabled) {
+            if (!ctx.yield()) return;
+            byKey[costKey(r)] = estimateUpdateCost(r, targets, langs, nullptr);
+            UpdateCost share = estimateUpdateCost(r, targets, langs, &seen);
+            total.known   |= share.known;
+            total.bytes   += share.bytes;
+            total.files   += share.files;
+            total.current += share.current;
+        }
+        std::lock_guard<std::mutex> lk(g_costs.mtx);
+        if (ctx.cancelled()) return;
+        g_costs.byKey = std::move(byKey);
+        g_costs.total = total;
+        g_costs.ready = true;
+        g_uiEpoch++;
+    });
+}
+
+// Main loop: re-estimate once a (re)load has settled
+static void refreshUpdateCosts(bool loading) {
+    if (!loading && g_costs.reposGen != g_reposGen) estimateCostsAsync(g_repos);
+}
+
+// Lists on disk changed (apt update ran): estimate again on the next pass
+static void invalidateUpdateCosts() {
+    g_costs.reposGen = 0;
+}
+
+static bool updateCostFor(const RepoEntry& r, UpdateCost& out) {
+    std::lock_guard<std::mutex> lk(g_costs.mtx);
+    auto it = g_costs.byKey.find(costKey(r));
+    if (it == g_costs.byKey.end()) return false;
+    out = it->second;
+    return true;
+}
+
+static std::string describeCost(const UpdateCost& c) {
+    if (!c.known) return "unknown (no cached Release)";
+    return humanBytes(c.bytes) + " in " + std::to_string(c.files) + " file" +
+           (c.files == 1 ? "" : "s") + " (" + std::to_string(c.current) + " current)";
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13B — ARCHITECTURE PRUNING ADVISOR
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  An entry without arch= fetches indexes for every architecture dpkg is
+//  configured for.  The advisor flags architectures an enabled entry
+//  fetches (or asks for) although dpkg is not configured for them or the
+//  archive does not publish them, and proposes the restriction to write.
+//  Savings are priced from the cached InRelease.
+
+struct ArchAdvice {
+    RepoEntry                entry;
+    std::vector<std::string> keep;     // restriction to write
+    std::vector<std::string> drop;     // "i386 (not configured in dpkg)"
+    bool                     priced     = false;   // savings known (InRelease cached)
+    uint64_t                 savedBytes = 0;
+    int                      savedFiles = 0;
+};
+
+// Runs on a Bulk worker: reads apt-config and every cached InRelease
+static std::vector<ArchAdvice> adviseArchPruning(const std::vector<RepoEntry>& repos,
+                                                 const std::atomic<bool>* cancel = nullptr) {
+    const auto& sys = systemArchitectures();
+    std::vector<IndexTargetSpec> targets;
+    std::vector<std::string>     langs;
+    aptIndexConfig(targets, langs);
+    auto has = [](const std::vector<std::string>& v, const std::string& s) {
+        return std::find(v.begin(), v.end(), s) != v.end();
+    };
+
+    std::vector<ArchAdvice> out;
+    for (const auto& r : repos) {
+        if (cancel && cancel->load()) return {};
+        if (!r.enabled || !has(splitWords(r.types), "deb")) continue;
+        ReleaseIndex rel;
+        readReleaseIndex(cachedReleasePath(r), rel);   // no cache: judge by dpkg alone
+
+        ArchAdvice a;
+        a.entry = r;
+        for (const auto& arch : r.archs.empty() ? sys : splitWords(r.archs)) {
+            if (arch == "all")                             a.keep.push_back(arch);
+            else if (!has(sys, arch))                      a.drop.push_back(arch + " (not configured in dpkg)");
+            else if (!rel.archs.empty() && !has(rel.archs, arch))
+                                                           a.drop.push_back(arch + " (not published by the archive)");
+            else                                           a.keep.push_back(arch);
+        }
+        if (a.drop.empty() || a.keep.empty()) continue;   // nothing to prune / nothing left
+
+        RepoEntry pruned = r;
+        pruned.archs.clear();
+        for (const auto& k : a.keep) pruned.archs += (pruned.archs.empty() ? "" : " ") + k;
+        UpdateCost before = estimateUpdateCost(r, targets, langs, nullptr);
+        UpdateCost after  = estimateUpdateCost(pruned, targets, langs, nullptr);
+        a.priced     = before.known;
+        a.savedBytes = before.listedBytes - after.listedBytes;
+        a.savedFiles = (before.files + before.current) - (after.files + after.current);
+        out.push_back(std::move(a));
+    }
+    return out;
+}
+
+// `line` with its arch= option set to `archs` (comma-joined), adding the
+// [options] block if the line has none
+static std::string setListArch(const std::string& line, const std::string& archs) {
+    size_t lead = line.find_first_not_of(" \t");
+    size_t typeEnd = line.find_first_of(" \t", lead);
+    if (lead == std::string::npos || typeEnd == std::string::npos) return line;
+    size_t optStart = line.find_first_not_of(" \t", typeEnd);
+    if (optStart == std::string::npos || line[optStart] != '[')
+        return line.substr(0, typeEnd) + " [arch=" + archs + "]" + line.substr(typeEnd);
+
+    size_t optEnd = line.find(']', optStart);
+    if (optEnd == std::string::npos) return line;
+    auto opts = splitWords(line.substr(optStart + 1, optEnd - optStart - 1));
+    bool found = false;
+    for (auto& o : opts)
+        if (o.rfind("arch=", 0) == 0) { o = "arch=" + archs; found = true; }
+    if (!found) opts.insert(opts.begin(), "arch=" + archs);
+    std::string block = "[";
+    for (size_t i = 0; i < opts.size(); i++) block += (i ? " " : "") + opts[i];
+    return line.substr(0, optStart) + block + "]" + line.substr(optEnd + 1);
+}
+
+// Write every restriction, all files or none (writeFileSet).  A deb822
+// stanza that yields several entries gets the union of their keeps; its
+// entries that were not advised keep everything they fetch now, so pruning
+// one suite never cuts another suite of the stanza off an architecture.
+// Such stanzas are named in `errMsg` along with any backup warnings.
+static bool applyArchAdvice(const std::vector<ArchAdvice>& advice, int& filesWritten, std::string& errMsg) {
+    std::map<std::string, std::vector<const ArchAdvice*>> byFile;
+    for (const auto& a : advice) byFile[a.entry.file].push_back(&a);
+
+    filesWritten = 0;
+    std::vector<FileWrite> todo;
+    std::vector<std::string> notes;
+    for (const auto& kv : byFile) {
+        const std::string& file = kv.first;
+        auto allLines = readAllLines(file);
+        const auto original = allLines;
+
+        if (!kv.second.front()->entry.isDeb822) {
+            for (const ArchAdvice* a : kv.second) {
+                std::string archs;
+                for (const auto& k : a->keep) archs += (archs.empty() ? "" : ",") + k;
+                for (auto& l : allLines)
+                    if (l == a->entry.display) { l = setListArch(l, archs); break; }
+            }
+        } else {
+            std::map<int, std::vector<std::string>> keepByBlock;
+            auto addArch = [](std::vector<std::string>& k, const std::string& arch) {
+                if (std::find(k.begin(), k.end(), arch) != k.end()) return false;
+                k.push_back(arch);
+                return true;
+            };
+            for (const ArchAdvice* a : kv.second)
+                for (const auto& arch : a->keep) addArch(keepByBlock[a->entry.blockIndex], arch);
+            // The stanza's other entries, counted as in disableEntries()
+            std::set<int> widened;
+            for (const auto& r : g_repos) {
+                if (r.file != file || !keepByBlock.count(r.blockIndex)) continue;
+                bool advised = std::any_of(kv.second.begin(), kv.second.end(), [&](const ArchAdvice* a) {
+                    return a->entry.blockIndex == r.blockIndex && a->entry.display == r.display;
+                });
+                if (advised) continue;
+                for (const auto& arch : r.archs.empty() ? systemArchitectures() : splitWords(r.archs))
+                    if (addArch(keepByBlock[r.blockIndex], arch)) widened.insert(r.blockIndex);
+            }
+            for (int b : widened)
+                notes.push_back(file + " stanza " + std::to_string(b) +
+                                " keeps the architectures its other URIs/suites fetch.");
+            // Walk blocks bottom-up so insertions don't shift pending ones
+            auto blocks = deb822BlockRanges(allLines);
+            for (auto it = keepByBlock.rbegin(); it != keepByBlock.rend(); ++it) {
+                if (it->first < 0 || it->first >= (int)blocks.size()) {
+                    errMsg = file + ": block index out of range (file changed externally?); nothing written";
+                    return false;
+                }
+                std::string val = "Architectures:";
+                for (const auto& k : it->second) val += " " + k;
+                const LineRange& b = blocks[it->first];
+                int at = -1;
+                for (int i = b.s; i <= b.e; i++)
+                    if (trimStr(allLines[i]).rfind("Architectures:", 0) == 0) { at = i; break; }
+                if (at >= 0) allLines[at] = val;
+                else         allLines.insert(allLines.begin() + b.s + 1, val);
+            }
+        }
+        todo.push_back({ file, original, std::move(allLines) });
+    }
+    if (!writeFileSet(todo, notes, errMsg)) return false;
+    filesWritten = (int)todo.size();
+    for (const auto& n : notes) errMsg += (errMsg.empty() ? "" : " ") + n;
+    return true;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13C — PACKAGE INDEXES (mmap'd control files)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  dpkg's status database and APT's Packages lists are deb822 control
+//  files of up to tens of MB.  They are mapped read-only and walked in
+//  place; only the fields a caller asks for are copied out.
+
+// Read-only mapping of a whole file; empty when missing or unreadable
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                m_data = static_cast<const char*>(p);
+                m_size = (size_t)st.st_size;
+                ::madvise(p, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    }
+    ~MappedFile() { if (m_data) ::munmap(const_cast<char*>(m_data), m_size); }
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool        ok()   const { return m_data != nullptr; }
+    const char* data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t      m_size = 0;
+};
+
+// One paragraph of a control file, pointing into the mapping
+struct Stanza {
+    const char* b;
+    const char* e;
+
+    // Value of a single-line field ("" if absent)
+    std::string_view field(std::string_view name) const {
+        for (const char* p = b; p < e; ) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(e - p)));
+            if (!nl) nl = e;
+            size_t len = (size_t)(nl - p);
+            if (len > name.size() && p[name.size()] == ':' &&
+                std::string_view(p, name.size()) == name) {
+                const char* v = p + name.size() + 1;
+                while (v < nl && (*v == ' ' || *v == '\t')) v++;
+                return std::string_view(v, (size_t)(nl - v));
+            }
+            p = nl + 1;
+        }
+        return {};
+    }
+};
+
+// Calls fn(const Stanza&) for each paragraph; fn returns false to stop
+template <class Fn>
+static void forEachStanza(const MappedFile& f, Fn fn) {
+    const char* p   = f.data();
+    const char* end = p + f.size();
+    while (p < end) {
+        while (p < end && *p == '\n') p++;              // blank separator lines
+        if (p >= end) break;
+        const char* q = p;
+        for (;;) {                                      // paragraph ends at "\n\n"
+            q = static_cast<const char*>(memchr(q, '\n', (size_t)(end - q)));
+            if (!q || q + 1 >= end) { q = end; break; }
+            if (q[1] == '\n') { q++; break; }
+            q++;
+        }
+        if (!fn(Stanza{p, q})) return;
+        p = q;
+    }
+}
+
+struct InstalledPkg { std::string name, arch, version; };
+
+// Packages dpkg reports as installed
+static std::vector<InstalledPkg> readInstalledPackages() {
+    std::vector<InstalledPkg> out;
+    MappedFile f("/var/lib/dpkg/status");
+    if (!f.ok()) return out;
+    forEachStanza(f, [&](const Stanza& s) {
+        std::string_view st = s.field("Status");
+        if (st.size() >= 10 && st.substr(st.size() - 10) == " installed")
+            out.push_back({std::string(s.field("Package")), std::string(s.field("Architecture")),
+                           std::string(s.field("Version"))});
+        return true;
+    });
+    return out;
+}
+
+// Local Packages list of one component/architecture of an entry
+static std::string packagesListPath(const RepoEntry& r, std::string comp, const std::string& arch) {
+    std::replace(comp.begin(), comp.end(), '/', '_');
+    return listsPrefix(r) + "_" + comp + "_binary-" + arch + "_Packages";
+}
+
+// Architectures whose Packages lists an entry reads (binary-all included)
+static std::vector<std::string> entryArchitectures(const RepoEntry& r) {
+    std::vector<std::string> a = r.archs.empty() ? systemArchitectures() : splitWords(r.archs);
+    if (std::find(a.begin(), a.end(), "all") == a.end()) a.push_back("all");
+    return a;
+}
+
+/* ─── unused-repository detector ──────────────────────────────────────────── */
+//
+//  An installed package is served by a repo when one of the repo's Packages
+//  lists carries its (name, architecture) at any version.  Matching the
+//  exact installed version would call a PPA that has published a newer
+//  build "unused" and offer to cut off the very upgrades it provides.
+
+struct RepoUsage {
+    RepoEntry entry;
+    bool      indexed   = false;     // at least one local Packages list found
+    int       installed = 0;         // installed packages this entry provides
+    std::vector<std::pair<std::string, int>> comps;   // component → count (-1: no list)
+};
+
+static std::string installedKey(std::string_view name, std::string_view arch) {
+    std::string k;
+    k.reserve(name.size() + arch.size() + 1);
+    k.append(name).push_back(' ');
+    k.append(arch);
+    return k;
+}
+
+static std::vector<RepoUsage> analyseRepoUsage(const std::vector<RepoEntry>& repos,
+                                               const std::atomic<bool>* cancel) {
+    std::unordered_map<std::string, int> installed;   // key → index
+    for (const auto& p : readInstalledPackages())
+        installed.emplace(installedKey(p.name, p.arch), (int)installed.size());
+
+    // list path → installed packages it carries (absent from map: not read yet)
+    std::unordered_map<std::string, std::unique_ptr<std::vector<int>>> perList;
+    auto listHits = [&](const std::string& path) -> const std::vector<int>* {
+        auto it = perList.find(path);
+        if (it != perList.end()) return it->second.get();
+        MappedFile f(path);
+        std::unique_ptr<std::vector<int>> hits;
+        if (f.ok()) {
+            hits = std::make_unique<std::vector<int>>();
+            forEachStanza(f, [&](const Stanza& s) {
+                auto h = installed.find(installedKey(s.field("Package"), s.field("Architecture")));
+                if (h != installed.end()) hits->push_back(h->second);
+                return !(cancel && cancel->load());
+            });
+        }
+        return (perList[path] = std::move(hits)).get();
+    };
+
+    std::vector<RepoUsage> out;
+    for (const auto& r : repos) {
+        if (cancel && cancel->load()) break;
+        auto types = splitWords(r.types);
+        if (!r.enabled || std::find(types.begin(), types.end(), "deb") == types.end()) continue;
+        RepoUsage u;
+        u.entry = r;
+        std::set<int> all;   // binary-all packages also appear in binary-<arch>
+        for (const auto& comp : splitWords(r.components)) {
+            std::set<int> seen;
+            bool listed = false;
+            for (const auto& arch : entryArchitectures(r))
+                if (const std::vector<int>* h = listHits(packagesListPath(r, comp, arch))) {
+                    listed = true;
+                    seen.insert(h->begin(), h->end());
+                }
+            if (listed) u.indexed = true;
+            all.insert(seen.begin(), seen.end());
+            u.comps.emplace_back(comp, listed ? (int)seen.size() : -1);
+        }
+        u.installed = (int)all.size();
+        out.push_back(std::move(u));
+    }
+    return out;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13D — UPGRADE CANDIDATES
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Debian-policy version ordering with keys built once per version string.
+//  Each part (upstream, revision) becomes a flat run of integers: every
+//  non-digit character mapped to its sort weight ('~' < end < letters <
+//  other), a 0 closing the non-digit run, then the value of the digit run.
+//  Two keys compare element by element with missing elements read as 0 —
+//  exactly dpkg's verrevcmp() without re-scanning either string.
+
+class DebVersion {
+public:
+    DebVersion() = default;
+    explicit DebVersion(std::string_view v) {
+        auto colon = v.find(':');
+        if (colon != std::string_view::npos) {
+            for (char c : v.substr(0, colon))
+                if (c >= '0' && c <= '9') m_epoch = m_epoch * 10 + (uint64_t)(c - '0');
+            v.remove_prefix(colon + 1);
+        }
+        auto dash = v.rfind('-');
+        encode(v.substr(0, dash), m_upstream);
+        if (dash != std::string_view::npos) encode(v.substr(dash + 1), m_revision);
+    }
+
+    int compare(const DebVersion& o) const {
+        if (m_epoch != o.m_epoch) return m_epoch < o.m_epoch ? -1 : 1;
+        if (int c = compareParts(m_upstream, o.m_upstream)) return c;
+        return compareParts(m_revision, o.m_revision);
+    }
+    bool operator<(const DebVersion& o) const { return compare(o) < 0; }
+
+private:
+    static void encode(std::string_view s, std::vector<int64_t>& out) {
+        size_t i = 0;
+        while (i < s.size()) {
+            for (; i < s.size() && !(s[i] >= '0' && s[i] <= '9'); i++) {
+                unsigned char c = (unsigned char)s[i];
+                out.push_back(c == '~' ? -1 : isalpha(c) ? c : c + 256);
+            }
+            out.push_back(0);
+            int64_t n = 0;
+            for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++)
+                n = std::min<int64_t>(n * 10 + (s[i] - '0'), INT64_MAX / 10);
+            out.push_back(n);
+        }
+    }
+    static int compareParts(const std::vector<int64_t>& a, const std::vector<int64_t>& b) {
+        size_t n = std::max(a.size(), b.size());
+        for (size_t i = 0; i < n; i++) {
+            int64_t x = i < a.size() ? a[i] : 0, y = i < b.size() ? b[i] : 0;
+            if (x != y) return x < y ? -1 : 1;
+        }
+        return 0;
+    }
+
+    uint64_t             m_epoch = 0;
+    std::vector<int64_t> m_upstream, m_revision;
+};
+
+struct UpgradeCount {
+    bool known    = false;   // false: no local Packages lists
+    int  upgrades = 0;       // installed packages with a newer version here
+    bool security = false;   // entry is a security pocket
+};
+
+static bool isSecurityPocket(const RepoEntry& r) {
+    const std::string s = r.suite;
+    return (s.size() >= 9 && s.compare(s.size() - 9, 9, "-security") == 0) ||
+           s.rfind("security", 0) == 0 || r.uri.find("security") != std::string::npos;
+}
+
+/* ─── installed-package → repos index ─────────────────────────────────────── */
+//
+//  One scan of every enabled entry's Packages lists yields, for each
+//  installed (name, arch), the versions each entry offers.  Upgrade counts
+//  are derived from it, and impact checks before F2/F4 answer from it
+//  without touching the lists again.
+
+struct PackageOffer {
+    int         repo;      // index into PackageIndex::repoKeys
+    int         comp;      // index into splitWords(entry.components)
+    DebVersion  version;
+    std::string text;      // version as written in the list
+};
+
+struct PackageIndex {
+    std::vector<InstalledPkg> installed;
+    std::vector<DebVersion>   installedVer;
+    std::vector<std::string>  repoKeys;       // costKey() of each enabled binary entry
+    std::vector<RepoEntry>    repoEntries;    // the entry behind each slot
+    std::vector<char>         repoKnown;      // entry had at least one local list
+    std::unordered_multimap<int, PackageOffer> offers;   // installed idx → offers
+};
+
+static std::shared_ptr<const PackageIndex> buildPackageIndex(const std::vector<RepoEntry>& repos,
+                                                             const std::atomic<bool>* cancel) {
+    auto ix = std::make_shared<PackageIndex>();
+    ix->installed = readInstalledPackages();
+    ix->installedVer.reserve(ix->installed.size());
+    std::unordered_map<std::string_view, std::vector<int>> byName;   // views into ix->installed
+    for (int i = 0; i < (int)ix->installed.size(); i++) {
+        ix->installedVer.emplace_back(ix->installed[i].version);
+        byName[ix->installed[i].name].push_back(i);
+    }
+
+    // list path → (installed idx, offered version) pairs (null: no list)
+    struct ListOffer { int idx; DebVersion version; std::string text; };
+    using Offers = std::vector<ListOffer>;
+    std::unordered_map<std::string, std::unique_ptr<Offers>> perList;
+    auto listOffers = [&](const std::string& path) -> const Offers* {
+        auto it = perList.find(path);
+        if (it != perList.end()) return it->second.get();
+        MappedFile f(path);
+        std::unique_ptr<Offers> hits;
+        if (f.ok()) {
+            hits = std::make_unique<Offers>();
+            forEachStanza(f, [&](const Stanza& s) {
+                auto n = byName.find(s.field("Package"));
+                if (n == byName.end()) return !(cancel && cancel->load());   // the common case
+                std::string_view arch = s.field("Architecture");
+                for (int idx : n->second)
+                    if (ix->installed[idx].arch == arch) {
+                        std::string_view v = s.field("Version");
+                        hits->push_back({idx, DebVersion(v), std::string(v)});
+                        break;
+                    }
+                return true;
+            });
+        }
+        return (perList[path] = std::move(hits)).get();
+    };
+
+    for (const auto& r : repos) {
+        if (cancel && cancel->load()) break;
+        auto types = splitWords(r.types);
+        if (!r.enabled || std::find(types.begin(), types.end(), "deb") == types.end()) continue;
+        int slot = (int)ix->repoKeys.size();
+        ix->repoKeys.push_back(costKey(r));
+        ix->repoEntries.push_back(r);
+        ix->repoKnown.push_back(0);
+        auto comps = splitWords(r.components);
+        for (int ci = 0; ci < (int)comps.size(); ci++)
+            for (const auto& arch : entryArchitectures(r))
+                if (const Offers* o = listOffers(packagesListPath(r, comps[ci], arch))) {
+                    ix->repoKnown[slot] = 1;
+                    for (const auto& lo : *o)
+                        ix->offers.emplace(lo.idx, PackageOffer{slot, ci, lo.version, lo.text});
+                }
+    }
+    return ix;
+}
+
+// costKey() → upgrade count, for every indexed entry
+static std::map<std::string, UpgradeCount> countUpgrades(const PackageIndex& ix,
+                                                         const std::vector<RepoEntry>& repos) {
+    std::vector<std::set<int>> newer(ix.repoKeys.size());
+    for (const auto& kv : ix.offers)
+        if (ix.installedVer[kv.first] < kv.second.version) newer[kv.second.repo].insert(kv.first);
+
+    std::map<std::string, UpgradeCount> out;
+    for (int slot = 0; slot < (int)ix.repoKeys.size(); slot++) {
+        UpgradeCount& c = out[ix.repoKeys[slot]];
+        c.known    = c.known || ix.repoKnown[slot];
+        c.upgrades = std::max(c.upgrades, (int)newer[slot].size());
+    }
+    for (const auto& r : repos) {
+        auto it = out.find(costKey(r));
+        if (it != out.end()) it->second.security = isSecurityPocket(r);
+    }
+    return out;
+}
+
+/* ─── impact of disabling / deleting an entry ─────────────────────────────── */
+
+struct RemovalImpact {
+    bool                     known = false;   // package index was ready
+    int                      orphaned   = 0;  // no source left at all
+    int                      downgraded = 0;  // only older versions left
+    std::vector<std::string> lines;           // one per affected package
+};
+
+struct UpgradeTable {
+    std::mutex                          mtx;
+    std::map<std::string, UpgradeCount> byKey;
+    std::shared_ptr<const PackageIndex> index;       // null until the first scan
+    std::atomic<uint64_t>               gen{0};      // bumped on publish (row cache key)
+    uint64_t                            reposGen = 0;   // main thread
+    std::shared_ptr<std::atomic<bool>>  cancel;
+};
+static UpgradeTable g_upgrades;
+
+static void countUpgradesAsync(const std::vector<RepoEntry>& repos) {
+    if (g_upgrades.cancel) g_upgrades.cancel->store(true);
+    g_upgrades.reposGen = g_reposGen;
+    g_upgrades.cancel = g_sched.submit(JobClass::Bulk, [repos](JobCtx& ctx) {
+        auto index = buildPackageIndex(repos, ctx.cancel.get());
+        if (ctx.cancelled()) return;
+        auto byKey = countUpgrades(*index, repos);
+        std::lock_guard<std::mutex> lk(g_upgrades.mtx);
+        if (ctx.cancelled()) return;
+        g_upgrades.byKey = std::move(byKey);
+        g_upgrades.index = std::move(index);
+        g_upgrades.gen++;
+        g_uiEpoch++;
+    });
+}
+
+// Main loop: recount once a (re)load has settled
+static void refreshUpgradeCounts(bool loading) {
+    if (!loading && g_upgrades.reposGen != g_reposGen) countUpgradesAsync(g_repos);
+}
+
+static void invalidateUpgradeCounts() {
+    g_upgrades.reposGen = 0;
+}
+
+static bool upgradeCountFor(const RepoEntry& r, UpgradeCount& out) {
+    std::lock_guard<std::mutex> lk(g_upgrades.mtx);
+    auto it = g_upgrades.byKey.find(costKey(r));
+    if (it == g_upgrades.byKey.end()) return false;
+    out = it->second;
+    return true;
+}
+
+// Installed packages that disabling or deleting `r` (with the rest of its
+// deb822 stanza) would leave without a source, or only with older versions
+static RemovalImpact removalImpact(const RepoEntry& r) {
+    RemovalImpact im;
+    std::shared_ptr<const PackageIndex> ix;
+    {
+        std::lock_guard<std::mutex> lk(g_upgrades.mtx);
+        ix = g_upgrades.index;
+    }
+    if (!ix) return im;
+    // F2/F4 act on the whole deb822 stanza (every suite/URI it yields) or
+    // on the one .list line: take all of those slots out together.
+    std::vector<char> gone(ix->repoEntries.size(), 0);
+    bool any = false;
+    im.known = true;
+    for (size_t i = 0; i < ix->repoEntries.size(); i++) {
+        const RepoEntry& e = ix->repoEntries[i];
+        bool same = e.file == r.file && (r.isDeb822 ? e.isDeb822 && e.blockIndex == r.blockIndex
+                                                    : e.display == r.display);
+        if (!same) continue;
+        gone[i] = 1;
+        any = true;
+        im.known = im.known && ix->repoKnown[i];
+    }
+    if (!any) return im;   // serves nothing
+
+    std::set<int> served;
+    for (const auto& kv : ix->offers)
+        if (gone[(size_t)kv.second.repo]) served.insert(kv.first);
+
+    for (int idx : served) {
+        const DebVersion* best = nullptr;
+        auto range = ix->offers.equal_range(idx);
+        for (auto it = range.first; it != range.second; ++it)
+            if (!gone[(size_t)it->second.repo] && (!best || *best < it->second.version))
+                best = &it->second.version;
+        const InstalledPkg& p = ix->installed[idx];
+        if (!best) {
+            im.orphaned++;
+            im.lines.push_back("no source   " + p.name + ":" + p.arch + " " + p.version);
+        } else if (*best < ix->installedVer[idx]) {
+            im.downgraded++;
+            im.lines.push_back("older only  " + p.name + ":" + p.arch + " " + p.version);
+        }
+    }
+    std::sort(im.lines.begin(), im.lines.end());
+    return im;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13E — APT PREFERENCES (pinning simulator)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Mirrors `apt-cache policy` for installed packages using the offers in
+//  the PackageIndex.  Every (entry, component) is a package source with
+//  release fields from its cached InRelease.  Release/origin clauses of all
+//  pins are evaluated once per source; per package only the Package: lines
+//  and version pins are checked.
+//
+//  Priorities: first matching package-specific pin, else first matching
+//  generic (Package: *) pin, else the source default — 990 for
+//  APT::Default-Release, 1 for NotAutomatic, 100 for NotAutomatic +
+//  ButAutomaticUpgrades, 500 otherwise.  The installed version also has
+//  priority 100.  The candidate is the highest priority, then the highest
+//  version; a candidate older than the installed version needs priority
+//  >= 1000, else the installed version stays.
+
+// A pin pattern, compiled once when the preferences are read: exact name,
+// glob (fnmatch) or /regex/, as APT accepts them
+class PinPattern {
+public:
+    PinPattern() = default;
+    explicit PinPattern(std::string text) : m_text(std::move(text)) {
+        if (m_text.size() >= 2 && m_text.front() == '/' && m_text.back() == '/') {
+            m_kind = Regex;
+            try { m_re = std::make_shared<const std::regex>(m_text.substr(1, m_text.size() - 2)); }
+            catch (const std::regex_error&) { m_kind = Never; }
+        } else if (m_text.find_first_of("*?[\\") != std::string::npos) {
+            m_kind = Glob;
+        }
+    }
+
+    const std::string& text()  const { return m_text; }
+    bool               empty() const { return m_text.empty(); }
+
+    bool matches(const std::string& value) const {
+        switch (m_kind) {
+            case Exact: return value == m_text;
+            case Glob:  return fnmatch(m_text.c_str(), value.c_str(), 0) == 0;
+            case Regex: return std::regex_search(value, *m_re);
+            case Never: break;
+        }
+        return false;
+    }
+
+private:
+    enum Kind { Exact, Glob, Regex, Never } m_kind = Exact;
+    std::string                       m_text;
+    std::shared_ptr<const std::regex> m_re;   // shared: stanzas are copied
+};
+
+// One pair of surrounding double quotes removed, as APT's versionmatch
+// does: `Pin: origin ""` is the pin for local sources
+static std::string unquotePin(std::string s) {
+    if (s.size() >= 2 && s.front() == '"' && s.back() == '"') s = s.substr(1, s.size() - 2);
+    return s;
+}
+
+struct PinStanza {
+    std::vector<PinPattern> packages;    // names, globs or /regex/; empty = generic
+    enum Kind { Release, Origin, Version } kind = Release;
+    std::vector<std::pair<char, PinPattern>> release;    // o= a= n= c= l= v= b=
+    PinPattern  value;                   // origin host or version pattern
+    int         priority = 0;
+    std::string where;                   // "file:line" for the report
+};
+
+// Preference files in APT's order: preferences, then preferences.d/* with
+// no extension or ".pref" (APT ignores everything else there)
+static std::vector<std::string> preferenceFiles() {
+    std::vector<std::string> files;
+    if (fs::exists("/etc/apt/preferences")) files.push_back("/etc/apt/preferences");
+    std::error_code ec;
+    std::vector<std::string> parts;
+    for (const auto& e : fs::directory_iterator("/etc/apt/preferences.d", ec)) {
+        auto name = e.path().filename().string();
+        auto ext  = e.path().extension().string();
+        if (name.empty() || name[0] == '.' || !(ext.empty() || ext == ".pref")) continue;
+        parts.push_back(e.path().string());
+    }
+    std::sort(parts.begin(), parts.end());
+    files.insert(files.end(), parts.begin(), parts.end());
+    return files;
+}
+
+static std::vector<PinStanza> readPreferences() {
+    std::vector<PinStanza> pins;
+    for (const auto& file : preferenceFiles()) {
+        auto lines = readAllLines(file);
+        lines.push_back("");                       // flush the last stanza
+        PinStanza p;
+        bool havePkg = false, havePin = false, havePrio = false;
+        int start = 0;
+        for (int i = 0; i < (int)lines.size(); i++) {
+            std::string t = trimStr(lines[i]);
+            if (t.empty()) {
+                if (havePkg && havePin && havePrio) {
+                    p.where = file + ":" + std::to_string(start + 1);
+                    pins.push_back(p);
+                }
+                p = PinStanza{}; havePkg = havePin = havePrio = false;
+                continue;
+            }
+            if (t[0] == '#') continue;
+            if (!havePkg && !havePin && !havePrio) start = i;
+            auto colon = t.find(':');
+            if (colon == std::string::npos) continue;
+            std::string key = toLower(t.substr(0, colon)), val = trimStr(t.substr(colon + 1));
+            if (key == "package") {
+                havePkg = true;
+                for (auto& w : splitWords(val)) if (w != "*") p.packages.emplace_back(w);
+            } else if (key == "pin") {
+                havePin = true;
+                auto sp = val.find(' ');
+                std::string kind = val.substr(0, sp), arg = sp == std::string::npos ? "" : trimStr(val.substr(sp));
+                if (kind == "origin") { p.kind = PinStanza::Origin; p.value = PinPattern(unquotePin(arg)); }
+                else if (kind == "version") { p.kind = PinStanza::Version; p.value = PinPattern(arg); }
+                else {
+                    p.kind = PinStanza::Release;
+                    std::stringstream ss(arg);
+                    std::string clause;
+                    while (std::getline(ss, clause, ',')) {
+                        clause = trimStr(clause);
+                        auto eq = clause.find('=');
+                        if (eq == 1) p.release.emplace_back(clause[0], PinPattern(unquotePin(clause.substr(2))));
+                        else if (!clause.empty()) {          // bare: a version if it starts with a digit
+                            clause = unquotePin(clause);
+                            p.release.emplace_back(isdigit((unsigned char)clause[0]) ? 'v' : 'a', PinPattern(clause));
+                        }
+                    }
+                }
+            } else if (key == "pin-priority") {
+                havePrio = true;
+                p.priority = atoi(val.c_str());
+            }
+        }
+    }
+    return pins;
+}
+
+// Release fields of one package source, as pins see them
+struct PinSource {
+    std::string origin, label, archive, codename, version, component, site;
+    int         defaultPriority = 500;
+};
+
+// Everything but the component, which the caller fills in per component:
+// the cached InRelease is read once per entry
+static PinSource pinSourceFor(const RepoEntry& r, const std::string& defaultRelease) {
+    PinSource s;
+    s.site = r.uri;
+    auto sp = s.site.find("://");
+    if (sp != std::string::npos) s.site = s.site.substr(sp + 3);
+    s.site = s.site.substr(0, s.site.find('/'));
+    bool notAuto = false, butAuto = false;
+    std::ifstream f(cachedReleasePath(r));
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.rfind("SHA256:", 0) == 0 || line.rfind("MD5Sum:", 0) == 0) break;
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string k = line.substr(0, colon), v = trimStr(line.substr(colon + 1));
+        if      (k == "Origin")   s.origin   = v;
+        else if (k == "Label")    s.label    = v;
+        else if (k == "Suite")    s.archive  = v;
+        else if (k == "Codename") s.codename = v;
+        else if (k == "Version")  s.version  = v;
+        else if (k == "NotAutomatic")         notAuto = (v == "yes");
+        else if (k == "ButAutomaticUpgrades") butAuto = (v == "yes");
+    }
+    if (s.archive.empty()) s.archive = r.suite;
+    if (!defaultRelease.empty() && (s.archive == defaultRelease || s.codename == defaultRelease))
+        s.defaultPriority = 990;
+    else if (notAuto) s.defaultPriority = butAuto ? 100 : 1;
+    return s;
+}
+
+// Release/origin part of a pin against one source (version pins: n/a)
+static bool pinMatchesSource(const PinStanza& p, const PinSource& s) {
+    if (p.kind == PinStanza::Origin) return p.value.empty() ? s.site.empty() : p.value.matches(s.site);
+    if (p.kind != PinStanza::Release) return true;
+    for (const auto& c : p.release) {
+        const std::string* f = nullptr;
+        switch (c.first) {
+            case 'o': f = &s.origin;    break;
+            case 'l': f = &s.label;     break;
+            case 'a': f = &s.archive;   break;
+            case 'n': f = &s.codename;  break;
+            case 'v': f = &s.version;   break;
+            case 'c': f = &s.component; break;
+            default:  continue;         // b= (architecture): every list here is ours
+        }
+        if (!c.second.matches(*f)) return false;
+    }
+    return true;
+}
+
+struct PolicyRow {
+    std::string package;     // name:arch
+    std::string installed;
+    std::string candidate;
+    int         priority = 0;
+    std::string from;        // winning source, or "dpkg status"
+    bool        pinned   = false;   // priority came from a preferences entry
+};
+
+struct PolicyModel {
+    std::vector<PinStanza>              pins;
+    std::vector<PolicyRow>              rows;          // installed packages, by name
+    std::map<std::string, std::string>  repoPriority;  // costKey() → "500" / "990 main, 1 contrib"
+    int                                 pinnedCount = 0;
+};
+
+static std::shared_ptr<const PolicyModel> buildPolicy(const PackageIndex& ix) {
+    auto pm = std::make_shared<PolicyModel>();
+    pm->pins = readPreferences();
+    const auto& pins = pm->pins;
+
+    std::string defaultRelease;
+    for (const auto& l : commandLines("apt-config dump APT::Default-Release 2>/dev/null")) {
+        auto q1 = l.find('"'), q2 = l.rfind('"');
+        if (l.rfind("APT::Default-Release ", 0) == 0 && q2 > q1) defaultRelease = l.substr(q1 + 1, q2 - q1 - 1);
+    }
+
+    // Per source: which pins' release/origin clauses match, and the
+    // priority a generic pin (or the default) gives it
+    struct SourceEval { std::vector<char> match; int generic; int genericPin; };
+    std::vector<std::vector<SourceEval>> eval(ix.repoEntries.size());
+    for (size_t slot = 0; slot < ix.repoEntries.size(); slot++) {
+        const RepoEntry& r = ix.repoEntries[slot];
+        std::string prio;
+        const PinSource entrySrc = pinSourceFor(r, defaultRelease);
+        for (const auto& comp : splitWords(r.components)) {
+            PinSource src = entrySrc;
+            src.component = comp;
+            SourceEval e{std::vector<char>(pins.size()), src.defaultPriority, -1};
+            for (size_t p = 0; p < pins.size(); p++) {
+                e.match[p] = pinMatchesSource(pins[p], src);
+                if (e.genericPin < 0 && pins[p].packages.empty() &&
+                    pins[p].kind != PinStanza::Version && e.match[p]) {
+                    e.genericPin = (int)p;
+                    e.generic    = pins[p].priority;
+                }
+            }
+            prio += (prio.empty() ? "" : ", ") + std::to_string(e.generic) + " " + comp;
+            eval[slot].push_back(std::move(e));
+        }
+        pm->repoPriority[ix.repoKeys[slot]] = prio;
+    }
+
+    // Package-specific pins, found once per package name
+    auto specificPins = [&](const std::string& name) {
+        std::vector<int> out;
+        for (size_t p = 0; p < pins.size(); p++)
+            for (const auto& pat : pins[p].packages)
+                if (pat.matches(name)) {
+                    out.push_back((int)p);
+                    break;
+                }
+        return out;
+    };
+
+    for (int idx = 0; idx < (int)ix.installed.size(); idx++) {
+        const InstalledPkg& pkg = ix.installed[idx];
+        std::vector<int> specific = specificPins(pkg.name);
+        struct Cand { const DebVersion* ver; const std::string* text; int prio; bool pinned; int slot, comp; };
+        std::vector<Cand> cands;
+        auto range = ix.offers.equal_range(idx);
+        for (auto it = range.first; it != range.second; ++it) {
+            const PackageOffer& o = it->second;
+            const SourceEval& se = eval[o.repo][o.comp];
+            int prio = se.generic;
+            bool pinned = se.genericPin >= 0;
+            for (int p : specific) {
+                bool m = pins[p].kind == PinStanza::Version ? pins[p].value.matches(o.text)
+                                                            : se.match[p];
+                if (m) { prio = pins[p].priority; pinned = true; break; }
+            }
+            cands.push_back({&o.version, &o.text, prio, pinned, o.repo, o.comp});
+        }
+        // The installed version is a source of its own at priority 100
+        int instPrio = 100;
+        bool instPinned = false;
+        for (int p : specific)
+            if (pins[p].kind == PinStanza::Version && pins[p].value.matches(pkg.version)) {
+                instPrio = pins[p].priority; instPinned = true; break;
+            }
+        cands.push_back({&ix.installedVer[idx], &pkg.version, instPrio, instPinned, -1, -1});
+
+        const Cand* best = nullptr;
+        for (const auto& c : cands) {
+            if (c.prio < 0) continue;   // never a candidate
+            if (!best || c.prio > best->prio ||
+                (c.prio == best->prio && best->ver->compare(*c.ver) < 0))
+                best = &c;
+        }
+        const Cand& inst = cands.back();
+        if (!best || (best->ver->compare(ix.installedVer[idx]) < 0 && best->prio < 1000)) best = &inst;
+
+        PolicyRow row;
+        row.package   = pkg.name + ":" + pkg.arch;
+        row.installed = pkg.version;
+        row.candidate = *best->text;
+        row.priority  = best->prio;
+        row.pinned    = best->pinned;
+        if (best->slot < 0) row.from = "dpkg status";
+        else {
+            const RepoEntry& r = ix.repoEntries[best->slot];
+            row.from = r.uri + " " + r.suite + "/" + splitWords(r.components)[best->comp];
+        }
+        if (row.pinned) pm->pinnedCount++;
+        pm->rows.push_back(std::move(row));
+    }
+    std::sort(pm->rows.begin(), pm->rows.end(),
+              [](const PolicyRow& a, const PolicyRow& b) { return a.package < b.package; });
+    return pm;
+}
+
+// Newest mtime and count of the preference files: a cheap change stamp
+static std::pair<int64_t, size_t> preferencesStamp() {
+    int64_t newest = 0;
+    auto files = preferenceFiles();
+    for (const auto& f : files) {
+        struct stat st;
+        if (stat(f.c_str(), &st) == 0) newest = std::max<int64_t>(newest, (int64_t)st.st_mtime);
+    }
+    return {newest, files.size()};
+}
+
+struct PolicyTable {
+    std::mutex                          mtx;
+    std::shared_ptr<const PolicyModel>  model;       // null until the first build
+    uint64_t                            indexGen = 0;   // main thread: g_upgrades.gen built from
+    std::pair<int64_t, size_t>          stamp{-1, 0};   // main thread: preferences it saw
+    std::chrono::steady_clock::time_point lastCheck;
+    std::shared_ptr<std::atomic<bool>>  cancel;
+};
+static PolicyTable g_policy;
+
+// Main loop: rebuild after a new package index, or when the preference
+// files change (checked every couple of seconds)
+static void refreshPolicy() {
+    std::shared_ptr<const PackageIndex> ix;
+    {
+        std::lock_guard<std::mutex> lk(g_upgrades.mtx);
+        ix = g_upgrades.index;
+    }
+    if (!ix) return;
+    auto now = std::chrono::steady_clock::now();
+    bool stale = g_policy.indexGen != g_upgrades.gen.load();
+    if (!stale && now - g_policy.lastCheck < std::chrono::seconds(2)) return;
+    g_policy.lastCheck = now;
+    auto stamp = preferencesStamp();
+    if (!stale && stamp == g_policy.stamp) return;
+
+    g_policy.indexGen = g_upgrades.gen.load();
+    g_policy.stamp    = stamp;
+    if (g_policy.cancel) g_policy.cancel->store(true);
+    g_policy.cancel = g_sched.submit(JobClass::Bulk, [ix](JobCtx& ctx) {
+        auto model = buildPolicy(*ix);
+        std::lock_guard<std::mutex> lk(g_policy.mtx);
+        if (ctx.cancelled()) return;
+        g_policy.model = std::move(model);
+        g_uiEpoch++;
+    });
+}
+
+static std::shared_ptr<const PolicyModel> currentPolicy() {
+    std::lock_guard<std::mutex> lk(g_policy.mtx);
+    return g_policy.model;
+}
+
+// "500", or per component when they differ: "990 main, 1 contrib"
+static bool repoPriorityFor(const RepoEntry& r, std::string& out) {
+    auto pm = currentPolicy();
+    if (!pm) return false;
+    auto it = pm->repoPriority.find(costKey(r));
+    if (it == pm->repoPriority.end()) return false;
+    std::set<std::string> prios;
+    for (auto& w : splitWords(it->second)) if (isdigit((unsigned char)w[0]) || w[0] == '-') prios.insert(w);
+    if (prios.size() == 1) out = *prios.begin();
+    else out = it->second;
+    return true;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13F — CONTENTS SEARCH (which package ships a file)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Contents-<arch> lists ("path  section/pkg[,section/pkg...]", sorted by
+//  path) are streamed through their decompressor once.  The reading thread
+//  cuts the stream into newline-aligned chunks; worker threads match the
+//  query and encode each chunk into index blocks, and the blocks are written
+//  back in order to ~/.cache/relix/contents/<list>.idx, stamped with the
+//  list's mtime and size.  At most a few chunks are in flight, so memory
+//  stays bounded whatever the list size.  Later queries map the cache and
+//  decode only the blocks whose trigram filter holds every trigram of the
+//  query.
+//
+//  Block: up to k_blockLines lines, each encoded as
+//    varint prefix shared with the previous path, varint suffix length,
+//    suffix, varint location length (0 = same as previous line), location
+//  Sorted paths and runs of one package keep this far below the raw list.
+
+static constexpr int      k_blockLines   = 256;
+static constexpr uint32_t k_filterBytes  = 1024;        // 8192-bit trigram filter per block
+static constexpr size_t   k_chunkBytes   = 4u << 20;
+static constexpr size_t   k_maxFileHits  = 500;         // kept per list; all are counted
+
+struct ContentsHit { std::string path, location; };
+
+struct ContentsBlockRef { uint64_t off; uint32_t len; uint32_t lines; };
+
+struct ContentsCacheHeader {
+    char     magic[8];      // "RLXCNT1"
+    int64_t  mtime;         // of the list it indexes
+    uint64_t size;
+    uint64_t lines;
+    uint64_t dirOff;        // filters, then block refs
+    uint32_t blocks;
+    uint32_t filterBytes;
+};
+
+struct ContentsEncoded {
+    std::string                   data;
+    std::vector<ContentsBlockRef> refs;      // offsets relative to `data`
+    std::string                   filters;
+    std::vector<ContentsHit>      hits;
+    uint64_t                      lines   = 0;
+    uint64_t                      matches = 0;
+};
+
+static void putVarint(std::string& o, uint64_t v) {
+    while (v >= 0x80) { o.push_back(char(v | 0x80)); v >>= 7; }
+    o.push_back(char(v));
+}
+
+static bool getVarint(const char*& p, const char* e, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < e && shift < 64; shift += 7) {
+        unsigned char b = (unsigned char)*p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline uint32_t trigramBit(const char* t) {
+    uint32_t k = uint32_t((unsigned char)t[0]) << 16 | uint32_t((unsigned char)t[1]) << 8 |
+                 (unsigned char)t[2];
+    return (k * 2654435761u) >> 19;     // 13 bits = k_filterBytes * 8
+}
+
+// "usr/bin/foo      utils/foo,admin/bar" → path, location.  Paths may
+// contain spaces; the location is the last whitespace-separated field.
+static bool splitContentsLine(std::string_view line, std::string_view& path, std::string_view& loc) {
+    size_t sp = line.find_last_of(" \t");
+    if (sp == std::string_view::npos || sp + 1 >= line.size()) return false;
+    size_t end = line.find_last_not_of(" \t", sp);
+    if (end == std::string_view::npos) return false;
+    path = line.substr(0, end + 1);
+    loc  = line.substr(sp + 1);
+    return true;
+}
+
+static void encodeContents(std::string_view text, std::string_view query, ContentsEncoded& out) {
+    std::string_view prevPath, prevLoc;
+    int    inBlock = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t nl = text.find('\n', pos);
+        if (nl == std::string_view::npos) nl = text.size();
+        std::string_view line = text.substr(pos, nl - pos), path, loc;
+        pos = nl + 1;
+        if (!splitContentsLine(line, path, loc)) continue;
+        if (path == "FILE" && loc == "LOCATION") continue;   // header of old-style lists
+
+        if (inBlock == 0) {
+            out.refs.push_back({out.data.size(), 0, 0});
+            out.filters.append(k_filterBytes, '\0');
+            prevPath = prevLoc = {};
+        }
+        size_t shared = 0, lim = std::min(prevPath.size(), path.size());
+        while (shared < lim && prevPath[shared] == path[shared]) shared++;
+        putVarint(out.data, shared);
+        putVarint(out.data, path.size() - shared);
+        out.data.append(path.data() + shared, path.size() - shared);
+        if (loc == prevLoc) putVarint(out.data, 0);
+        else { putVarint(out.data, loc.size()); out.data.append(loc.data(), loc.size()); }
+
+        // Trigrams inside the shared prefix are already in the filter
+        char* filter = &out.filters[out.filters.size() - k_filterBytes];
+        for (size_t i = shared >= 2 ? shared - 2 : 0; i + 3 <= path.size(); i++) {
+            uint32_t b = trigramBit(path.data() + i);
+            filter[b >> 3] |= char(1u << (b & 7));
+        }
+        prevPath = path;
+        prevLoc  = loc;
+        out.refs.back().lines++;
+        out.lines++;
+        if (++inBlock == k_blockLines) {
+            out.refs.back().len = uint32_t(out.data.size() - out.refs.back().off);
+            inBlock = 0;
+        }
+        if (path.find(query) != std::string_view::npos) {
+            out.matches++;
+            if (out.hits.size() < k_maxFileHits) out.hits.push_back({std::string(path), std::string(loc)});
+        }
+    }
+    if (inBlock) out.refs.back().len = uint32_t(out.data.size() - out.refs.back().off);
+}
+
+static std::string decompressorFor(const std::string& path) {
+    auto ends = [&](const char* ext) {
+        size_t n = strlen(ext);
+        return path.size() > n && path.compare(path.size() - n, n, ext) == 0;
+    };
+    if (ends(".lz4")) return "lz4 -dc";
+    if (ends(".gz"))  return "gzip -dc";
+    if (ends(".xz"))  return "xz -dc";
+    if (ends(".zst")) return "zstd -dc";
+    return "cat";
+}
+
+static int contentsThreads() {
+    return (int)std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+}
+
+struct ContentsFileResult {
+    std::vector<ContentsHit> hits;
+    uint64_t                 matches = 0;
+    bool                     cached  = false;
+};
+
+// Stream `list` through its decompressor, matching and indexing it in
+// parallel; the cache is written to a temp file and renamed into place
+static bool streamContents(const std::string& list, const struct stat& st, const std::string& cachePath,
+                           std::string_view query, ContentsFileResult& res, JobCtx& ctx) {
+    FILE* pipe = popen((decompressorFor(list) + " " + shellQuote(list) + " 2>/dev/null").c_str(), "r");
+    if (!pipe) return false;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(cachePath).parent_path(), ec);
+    std::string tmp = cachePath + ".tmp." + std::to_string(getpid());
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    ContentsCacheHeader hdr{};
+    memcpy(hdr.magic, "RLXCNT1", 8);
+    hdr.mtime = (int64_t)st.st_mtime;
+    hdr.size  = (uint64_t)st.st_size;
+    hdr.filterBytes = k_filterBytes;
+    if (out) out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    uint64_t dataOff = sizeof(hdr);
+    std::vector<ContentsBlockRef> refs;
+    std::string filters;
+
+    struct Chunk { size_t seq; std::string text; };
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<Chunk> todo;
+    std::map<size_t, ContentsEncoded> done;
+    bool eof = false;
+    const int nThreads = contentsThreads();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&] {
+            for (;;) {
+                std::unique_lock<std::mutex> lk(mtx);
+                cv.wait(lk, [&] { return !todo.empty() || eof; });
+                if (todo.empty()) return;
+                Chunk c = std::move(todo.front());
+                todo.erase(todo.begin());
+                lk.unlock();
+                ContentsEncoded enc;
+                encodeContents(c.text, query, enc);
+                lk.lock();
+                done.emplace(c.seq, std::move(enc));
+                cv.notify_all();
+            }
+        });
+
+    // Append finished chunks in sequence order (caller holds `lk`)
+    size_t nextSeq = 0, inFlight = 0;
+    auto drain = [&](std::unique_lock<std::mutex>& lk) {
+        for (auto it = done.find(nextSeq); it != done.end(); it = done.find(nextSeq)) {
+            ContentsEncoded enc = std::move(it->second);
+            done.erase(it);
+            lk.unlock();
+            for (auto r : enc.refs) { r.off += dataOff; refs.push_back(r); }
+            filters += enc.filters;
+            if (out) out.write(enc.data.data(), (std::streamsize)enc.data.size());
+            dataOff   += enc.data.size();
+            hdr.lines += enc.lines;
+            res.matches += enc.matches;
+            for (auto& h : enc.hits)
+                if (res.hits.size() < k_maxFileHits) res.hits.push_back(std::move(h));
+            lk.lock();
+            nextSeq++;
+            inFlight--;
+        }
+    };
+
+    std::string carry;
+    std::vector<char> buf(k_chunkBytes);
+    size_t seq = 0;
+    bool cancelled = false;
+    for (;;) {
+        size_t n = fread(buf.data(), 1, buf.size(), pipe);
+        if (n == 0 && carry.empty()) break;
+        std::string text = std::move(carry);
+        text.append(buf.data(), n);
+        carry.clear();
+        if (n > 0) {
+            size_t nl = text.rfind('\n');
+            if (nl == std::string::npos) { carry = std::move(text); continue; }
+            carry.assign(text, nl + 1, std::string::npos);
+            text.resize(nl + 1);
+        }
+        std::unique_lock<std::mutex> lk(mtx);
+        while (inFlight >= (size_t)nThreads * 2) {
+            cv.wait(lk, [&] { return done.count(nextSeq) > 0; });
+            drain(lk);
+        }
+        todo.push_back({seq++, std::move(text)});
+        inFlight++;
+        cv.notify_all();
+        lk.unlock();
+        if (n == 0 || (cancelled = !ctx.yield())) break;
+    }
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        eof = true;
+        cv.notify_all();
+        while (inFlight) {
+            cv.wait(lk, [&] { return done.count(nextSeq) > 0; });
+            drain(lk);
+        }
+    }
+    for (auto& w : workers) w.join();
+    int status = pclose(pipe);
+
+    if (cancelled || status != 0 || !out) { out.close(); fs::remove(tmp, ec); return !cancelled && status == 0; }
+    hdr.dirOff = dataOff;
+    hdr.blocks = (uint32_t)refs.size();
+    out.write(filters.data(), (std::streamsize)filters.size());
+    out.write(reinterpret_cast<const char*>(refs.data()), (std::streamsize)(refs.size() * sizeof(ContentsBlockRef)));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    out.close();
+    if (!out || ::rename(tmp.c_str(), cachePath.c_str()) != 0) fs::remove(tmp, ec);
+    return true;
+}
+
+// Query a cache made by streamContents(); false when missing or stale
+static bool searchContentsCache(const std::string& cachePath, const struct stat& st,
+                                std::string_view query, ContentsFileResult& res) {
+    MappedFile f(cachePath);
+    if (!f.ok() || f.size() < sizeof(ContentsCacheHeader)) return false;
+    ContentsCacheHeader hdr;
+    memcpy(&hdr, f.data(), sizeof(hdr));
+    if (memcmp(hdr.magic, "RLXCNT1", 8) != 0 || hdr.mtime != (int64_t)st.st_mtime ||
+        hdr.size != (uint64_t)st.st_size || hdr.filterBytes != k_filterBytes ||
+        hdr.dirOff + uint64_t(hdr.blocks) * (k_filterBytes + sizeof(ContentsBlockRef)) != f.size())
+        return false;
+    const char* filters = f.data() + hdr.dirOff;
+    std::vector<ContentsBlockRef> refs(hdr.blocks);
+    memcpy(refs.data(), filters + uint64_t(hdr.blocks) * k_filterBytes, refs.size() * sizeof(ContentsBlockRef));
+
+    std::vector<uint32_t> need;
+    for (size_t i = 0; i + 3 <= query.size(); i++) need.push_back(trigramBit(query.data() + i));
+
+    // Blocks are independent: split them across threads, merge in order
+    const int nThreads = contentsThreads();
+    std::vector<ContentsFileResult> part(nThreads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++)
+        workers.emplace_back([&, t] {
+            size_t lo = refs.size() * t / nThreads, hi = refs.size() * (t + 1) / nThreads;
+            std::string path;
+            for (size_t b = lo; b < hi; b++) {
+                const char* filter = filters + b * k_filterBytes;
+                bool maybe = true;
+                for (uint32_t bit : need)
+                    if (!(filter[bit >> 3] & (1u << (bit & 7)))) { maybe = false; break; }
+                if (!maybe || refs[b].off + refs[b].len > hdr.dirOff) continue;
+                const char* p = f.data() + refs[b].off;
+                const char* e = p + refs[b].len;
+                std::string_view loc;
+                path.clear();
+                for (uint32_t l = 0; l < refs[b].lines; l++) {
+                    uint64_t shared, suffix, locLen;
+                    if (!getVarint(p, e, shared) || !getVarint(p, e, suffix) ||
+                        shared > path.size() || suffix > uint64_t(e - p)) break;
+                    path.resize(shared);
+                    path.append(p, suffix);
+                    p += suffix;
+                    if (!getVarint(p, e, locLen) || locLen > uint64_t(e - p)) break;
+                    if (locLen) { loc = std::string_view(p, locLen); p += locLen; }
+                    if (path.find(query) != std::string::npos) {
+                        part[t].matches++;
+                        if (part[t].hits.size() < k_maxFileHits) part[t].hits.push_back({path, std::string(loc)});
+                    }
+                }
+            }
+        });
+    for (auto& w : workers) w.join();
+    res.cached = true;
+    for (auto& p : part) {
+        res.matches += p.matches;
+        for (auto& h : p.hits)
+            if (res.hits.size() < k_maxFileHits) res.hits.push_back(std::move(h));
+    }
+    return true;
+}
+
+// Local Contents lists of the enabled entries, each with the entries
+// ("uri suite") it belongs to
+static std::vector<std::pair<std::string, std::string>> contentsLists(const std::vector<RepoEntry>& repos) {
+    static const char* const exts[] = {"", ".lz4", ".gz", ".xz", ".zst"};
+    std::vector<std::pair<std::string, std::string>> out;
+    std::set<std::string> seen;
+    for (const auto& r : repos) {
+        auto types = splitWords(r.types);
+        if (!r.enabled || std::find(types.begin(), types.end(), "deb") == types.end()) continue;
+        std::vector<std::string> bases;
+        for (std::string comp : splitWords(r.components)) {
+            std::replace(comp.begin(), comp.end(), '/', '_');
+            for (const auto& a : entryArchitectures(r))
+                bases.push_back(listsPrefix(r) + "_" + comp + "_Contents-" + a);
+        }
+        for (const auto& a : entryArchitectures(r))
+            bases.push_back(listsPrefix(r) + "_Contents-" + a);        // pre-component layout
+        for (const auto& b : bases)
+            for (const char* ext : exts) {
+                std::string p = b + ext;
+                if (!seen.count(p) && fs::exists(p)) {
+                    seen.insert(p);
+                    out.emplace_back(p, r.uri + " " + r.suite);
+                    break;
+                }
+            }
+    }
+    return out;
+}
+
+struct ContentsSearch {
+    std::vector<std::string> lines;      // report, grouped by list
+    uint64_t                 matches = 0;
+    int                      lists   = 0;
+    int                      cached  = 0;
+};
+
+static ContentsSearch searchContents(const std::vector<RepoEntry>& repos, std::string query, JobCtx& ctx) {
+    ContentsSearch s;
+    while (!query.empty() && query[0] == '/') query.erase(0, 1);   // lists omit the root slash
+    const std::string cacheRoot = cacheDir() + "/contents";
+    auto lists = contentsLists(repos);
+    s.lists = (int)lists.size();
+
+    std::set<std::string> live;
+    for (const auto& l : lists) {
+        if (ctx.cancelled()) break;
+        struct stat st;
+        if (stat(l.first.c_str(), &st) != 0) continue;
+        std::string name = fs::path(l.first).filename().string();
+        std::string cachePath = cacheRoot + "/" + name + ".idx";
+        live.insert(name + ".idx");
+        ContentsFileResult res;
+        if (!searchContentsCache(cachePath, st, query, res) &&
+            !streamContents(l.first, st, cachePath, query, res, ctx)) {
+            s.lines.push_back(l.second + "  (" + name + "): cannot decompress");
+            continue;
+        }
+        if (res.cached) s.cached++;
+        s.matches += res.matches;
+        if (res.hits.empty()) continue;
+        s.lines.push_back(l.second + "  (" + name + ")  " + std::to_string(res.matches) + " match" +
+                          (res.matches == 1 ? "" : "es"));
+        for (const auto& h : res.hits) {
+            std::string path = "/" + h.path;
+            if (path.size() < 48) path.resize(48, ' ');
+            s.lines.push_back("    " + path + "  " + h.location);
+        }
+        if (res.matches > res.hits.size())
+            s.lines.push_back("    ... " + std::to_string(res.matches - res.hits.size()) + " more");
+    }
+
+    // Drop caches of lists that are gone from /var/lib/apt/lists
+    std::error_code ec;
+    for (const auto& e : fs::directory_iterator(cacheRoot, ec)) {
+        std::string name = e.path().filename().string();
+        if (live.count(name) || name.size() < 4 || name.compare(name.size() - 4, 4, ".idx") != 0) continue;
+        if (!fs::exists("/var/lib/apt/lists/" + name.substr(0, name.size() - 4))) fs::remove(e.path(), ec);
+    }
+    return s;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13G — PACKAGE TEXT SEARCH
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Case-insensitive substring search over the Package and Description
+//  fields of every enabled entry's local Packages lists.  The kernel scans
+//  the mapped list for the query's first and last byte at once (AVX2 or
+//  SSE2 where the CPU has them, scalar otherwise), ASCII-folding with an OR
+//  of 0x20, and verifies candidates byte by byte.  A hit only locates its
+//  paragraph: the paragraph is scored once from its name and description
+//  and the scan resumes after it, so a package with many matching fields
+//  costs one verification.  Results are published per list, so the list
+//  view fills in while the search runs.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define RELIX_X86_SIMD 1
+#endif
+
+static inline unsigned char foldAscii(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
+// `low` is already folded
+static inline bool equalsFolded(const char* p, const std::string& low) {
+    for (size_t i = 0; i < low.size(); i++)
+        if (foldAscii((unsigned char)p[i]) != (unsigned char)low[i]) return false;
+    return true;
+}
+
+static const char* findFoldedScalar(const char* p, const char* end, const std::string& low) {
+    if ((size_t)(end - p) < low.size()) return nullptr;
+    const unsigned char first = (unsigned char)low[0];
+    for (const char* last = end - low.size(); p <= last; p++)
+        if (foldAscii((unsigned char)*p) == first && equalsFolded(p, low)) return p;
+    return nullptr;
+}
+
+#ifdef RELIX_X86_SIMD
+// Letters match either case after OR 0x20; other bytes match exactly
+static inline char foldMask(char c) { return (c >= 'a' && c <= 'z') ? 0x20 : 0; }
+
+static const char* findFoldedSse2(const char* p, const char* end, const std::string& low) {
+    const size_t n = low.size();
+    if ((size_t)(end - p) < n) return nullptr;
+    const char* last = end - n;                       // last valid start
+    const __m128i first = _mm_set1_epi8(low[0]),      firstMask = _mm_set1_epi8(foldMask(low[0]));
+    const __m128i tail  = _mm_set1_epi8(low[n - 1]),  tailMask  = _mm_set1_epi8(foldMask(low[n - 1]));
+    for (; last - p >= 15; p += 16) {
+        __m128i a = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), firstMask);
+        __m128i b = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + n - 1)), tailMask);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                                  _mm_cmpeq_epi8(b, tail)));
+        for (; mask; mask &= mask - 1) {
+            const char* c = p + __builtin_ctz(mask);
+            if (equalsFolded(c, low)) return c;
+        }
+    }
+    return findFoldedScalar(p, end, low);
+}
+
+__attribute__((target("avx2")))
+static const char* findFoldedAvx2(const char* p, const char* end, const std::string& low) {
+    const size_t n = low.size();
+    if ((size_t)(end - p) < n) return nullptr;
+    const char* last = end - n;
+    const __m256i first = _mm256_set1_epi8(low[0]),     firstMask = _mm256_set1_epi8(foldMask(low[0]));
+    const __m256i tail  = _mm256_set1_epi8(low[n - 1]), tailMask  = _mm256_set1_epi8(foldMask(low[n - 1]));
+    for (; last - p >= 31; p += 32) {
+        __m256i a = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), firstMask);
+        __m256i b = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + n - 1)), tailMask);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                        _mm256_cmpeq_epi8(b, tail)));
+        for (; mask; mask &= mask - 1) {
+            const char* c = p + __builtin_ctz(mask);
+            if (equalsFolded(c, low)) return c;
+        }
+    }
+    return findFoldedSse2(p, end, low);
+}
+#endif
+
+using FindFoldedFn = const char* (*)(const char*, const char*, const std::string&);
+
+// Widest kernel this CPU runs, chosen once
+static FindFoldedFn findFolded() {
+    static const FindFoldedFn fn = [] {
+#ifdef RELIX_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return &findFoldedAvx2;
+        return &findFoldedSse2;
+#else
+        return &findFoldedScalar;
+#endif
+    }();
+    return fn;
+}
+
+static bool containsFolded(std::string_view s, const std::string& low) {
+    return findFolded()(s.data(), s.data() + s.size(), low) != nullptr;
+}
+
+struct PkgHit {
+    int         score = 0;
+    std::string name, version, summary;
+};
+
+// Name match beats summary beats long description
+static int scorePackage(std::string_view name, std::string_view summary, std::string_view longDesc,
+                        const std::string& low) {
+    if (name.size() == low.size() && equalsFolded(name.data(), low)) return 100;
+    if (name.size() >= low.size() && equalsFolded(name.data(), low))  return 80;
+    if (containsFolded(name, low))     return 60;
+    if (containsFolded(summary, low))  return 30;
+    if (containsFolded(longDesc, low)) return 10;
+    return 0;
+}
+
+// The continuation lines of the Description field (long description)
+static std::string_view longDescription(const Stanza& s, std::string_view summary) {
+    if (summary.empty()) return {};
+    const char* b = summary.data() + summary.size();
+    const char* p = b;
+    while (p < s.e && *p == '\n' && p + 1 < s.e && (p[1] == ' ' || p[1] == '\t')) {
+        const char* nl = static_cast<const char*>(memchr(p + 1, '\n', (size_t)(s.e - p - 1)));
+        p = nl ? nl : s.e;
+    }
+    return std::string_view(b, (size_t)(p - b));
+}
+
+// Scan one mapped list; fn(const PkgHit&) per matching paragraph
+template <class Fn>
+static void searchPackagesList(const MappedFile& f, const std::string& low, Fn fn) {
+    const char* base = f.data();
+    const char* end  = base + f.size();
+    const FindFoldedFn find = findFolded();
+    for (const char* p = base; p < end; ) {
+        const char* hit = find(p, end, low);
+        if (!hit) break;
+        // Paragraph around the hit; it cannot start before the resume point
+        const char* s = hit;
+        for (;;) {
+            const void* nl = memrchr(p, '\n', (size_t)(s - p));
+            if (!nl) { s = p; break; }
+            const char* c = static_cast<const char*>(nl);
+            if (c == base || c[-1] == '\n') { s = c + 1; break; }
+            s = c;
+        }
+        const char* e = hit;
+        for (;;) {
+            e = static_cast<const char*>(memchr(e, '\n', (size_t)(end - e)));
+            if (!e || e + 1 >= end) { e = end; break; }
+            if (e[1] == '\n') { e++; break; }
+            e++;
+        }
+        Stanza st{s, e};
+        std::string_view name = st.field("Package"), summary = st.field("Description");
+        int score = scorePackage(name, summary, longDescription(st, summary), low);
+        if (score > 0) fn(PkgHit{score, std::string(name), std::string(st.field("Version")), std::string(summary)});
+        p = e;
+    }
+}
+
+struct PkgSearchTable {
+    std::mutex                                   mtx;
+    std::map<std::string, std::shared_ptr<const std::vector<PkgHit>>> byKey;   // costKey() → hits, best first
+    std::atomic<uint64_t>                        gen{0};     // bumped per published repository
+    std::atomic<bool>                            running{false};
+    std::atomic<int>                             listsDone{0}, listsTotal{0};
+    std::shared_ptr<std::atomic<bool>>           cancel;
+    std::string                                  query;      // main thread; empty = inactive
+    uint64_t                                     shownGen = 0;   // main thread
+};
+static PkgSearchTable g_pkgSearch;
+
+static void cancelPkgSearch() {
+    if (g_pkgSearch.cancel) g_pkgSearch.cancel->store(true);
+    g_pkgSearch.running = false;
+}
+
+static void clearPkgSearch() {
+    cancelPkgSearch();
+    g_pkgSearch.query.clear();
+    std::lock_guard<std::mutex> lk(g_pkgSearch.mtx);
+    g_pkgSearch.byKey.clear();
+    g_pkgSearch.gen++;
+}
+
+// `done(packages, repositories)` runs on the main thread unless cancelled
+static void startPkgSearchJob(const std::vector<RepoEntry>& repos, const std::string& query,
+                              std::function<void(size_t, size_t)> done) {
+    clearPkgSearch();
+    g_pkgSearch.query = query;
+    std::string low;
+    for (char c : query) low += (char)foldAscii((unsigned char)c);
+
+    // costKey → its list files; a list shared by several keys is scanned once
+    std::map<std::string, std::vector<std::string>> groups;
+    std::map<std::string, int> uses;
+    int total = 0;
+    for (const auto& r : repos) {
+        if (!r.enabled) continue;
+        auto& g = groups[costKey(r)];
+        if (!g.empty()) continue;
+        for (const auto& comp : splitWords(r.components))
+            for (const auto& a : entryArchitectures(r)) {
+                std::string p = packagesListPath(r, comp, a);
+                if (fs::exists(p)) { g.push_back(p); uses[p]++; total++; }
+            }
+    }
+    g_pkgSearch.listsDone  = 0;
+    g_pkgSearch.listsTotal = total;
+    g_pkgSearch.running    = true;
+    g_pkgSearch.cancel = g_sched.submit(JobClass::Interactive, [groups, uses, low, done](JobCtx& ctx) {
+        std::map<std::string, std::vector<PkgHit>> shared;    // hits of lists used by several keys
+        size_t packages = 0, repoCount = 0;
+        for (const auto& g : groups) {
+            std::vector<PkgHit> hits;
+            std::unordered_map<std::string, size_t> byName;   // dedupe across archs/components
+            for (const auto& list : g.second) {
+                if (!ctx.yield()) return;
+                std::vector<PkgHit> scanned;
+                auto sh = shared.find(list);
+                if (sh != shared.end()) scanned = sh->second;
+                else {
+                    MappedFile f(list);
+                    if (f.ok()) searchPackagesList(f, low, [&](PkgHit&& h) { scanned.push_back(std::move(h)); });
+                    if (uses.at(list) > 1) shared.emplace(list, scanned);
+                }
+                if (g.second.size() == 1) { hits = std::move(scanned); break; }
+                for (auto& h : scanned) {
+                    auto it = byName.find(h.name);
+                    if (it == byName.end()) { byName.emplace(h.name, hits.size()); hits.push_back(std::move(h)); continue; }
+                    PkgHit& best = hits[it->second];
+                    if (h.score > best.score ||
+                        (h.score == best.score && DebVersion(best.version) < DebVersion(h.version)))
+                        best = std::move(h);
+                }
+                g_pkgSearch.listsDone++;
+            }
+            if (g.second.size() == 1) g_pkgSearch.listsDone++;
+            std::sort(hits.begin(), hits.end(), [](const PkgHit& a, const PkgHit& b) {
+                return a.score != b.score ? a.score > b.score : a.name < b.name;
+            });
+            if (!hits.empty()) { packages += hits.size(); repoCount++; }
+            auto ranked = std::make_shared<const std::vector<PkgHit>>(std::move(hits));
+            std::lock_guard<std::mutex> lk(g_pkgSearch.mtx);
+            if (ctx.cancelled()) return;
+            if (!ranked->empty()) {
+                g_pkgSearch.byKey[g.first] = std::move(ranked);
+                g_pkgSearch.gen++;
+                g_uiEpoch++;
+            }
+        }
+        postToUi([done, packages, repoCount, cancel = ctx.cancel] {
+            if (cancel->load()) return;
+            g_pkgSearch.running = false;
+            done(packages, repoCount);
+        });
+    });
+}
+
+// Ranked hits of `r` for the active search (null when it has none)
+static std::shared_ptr<const std::vector<PkgHit>> pkgSearchHitsFor(const RepoEntry& r) {
+    std::lock_guard<std::mutex> lk(g_pkgSearch.mtx);
+    auto it = g_pkgSearch.byKey.find(costKey(r));
+    return it == g_pkgSearch.byKey.end() ? nullptr : it->second;
+}
+
+static size_t pkgSearchCountFor(const RepoEntry& r) {
+    std::lock_guard<std::mutex> lk(g_pkgSearch.mtx);
+    auto it = g_pkgSearch.byKey.find(costKey(r));
+    return it == g_pkgSearch.byKey.end() ? 0 : it->second->size();
+}
+
+static bool pkgSearchHides(const RepoEntry& r) {
+    return !g_pkgSearch.query.empty() && pkgSearchCountFor(r) == 0;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13H — INDEX DELTA (what the last apt update brought in)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  For every local Packages list a compact snapshot of (package, version,
+//  stanza hash) is kept in ~/.cache/relix/snapshots/<list>.cur, stamped
+//  with the hash of the list it was taken from.  When the list's hash no
+//  longer matches (apt update replaced it), .cur becomes .prev and a new
+//  .cur is taken.  Records are sorted by (name hash, version hash), so
+//  prev and cur are compared in one merge pass.  An unchanged mtime/size
+//  skips hashing the list.
+
+static uint64_t hashBytes(const char* p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    for (; i < n; i++) h = (h ^ (unsigned char)p[i]) * 0x100000001b3ull;
+    h ^= h >> 29;
+    return h * 0xc4ceb9fe1a85ec53ull;
+}
+
+struct SnapRecord {
+    uint64_t nameHash, versionHash, stanzaHash;
+    uint32_t nameOff, versionOff;            // into the string table
+};
+
+struct SnapHeader {
+    char     magic[8];      // "RLXSNP1"
+    uint64_t listHash;
+    int64_t  listMtime;
+    uint64_t listSize;
+    int64_t  taken;         // when the snapshot was made
+    uint32_t records;
+    uint32_t stringBytes;
+};
+
+struct Snapshot {
+    SnapHeader              hdr{};
+    std::vector<SnapRecord> recs;
+    std::string             strings;        // NUL-terminated names and versions
+
+    const char* str(uint32_t off) const { return strings.c_str() + off; }
+};
+
+static bool readSnapshot(const std::string& path, Snapshot& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.read(reinterpret_cast<char*>(&out.hdr), sizeof(out.hdr)) ||
+        memcmp(out.hdr.magic, "RLXSNP1", 8) != 0)
+        return false;
+    out.recs.resize(out.hdr.records);
+    out.strings.resize(out.hdr.stringBytes);
+    f.read(reinterpret_cast<char*>(out.recs.data()), (std::streamsize)(out.recs.size() * sizeof(SnapRecord)));
+    f.read(&out.strings[0], (std::streamsize)out.strings.size());
+    if (!f) return false;
+    for (const auto& r : out.recs)
+        if (r.nameOff >= out.strings.size() || r.versionOff >= out.strings.size()) return false;
+    return out.strings.empty() || out.strings.back() == '\0';
+}
+
+static bool writeSnapshot(const std::string& path, const Snapshot& s) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        f.write(reinterpret_cast<const char*>(&s.hdr), sizeof(s.hdr));
+        f.write(reinterpret_cast<const char*>(s.recs.data()), (std::streamsize)(s.recs.size() * sizeof(SnapRecord)));
+        f.write(s.strings.data(), (std::streamsize)s.strings.size());
+        if (!f) { std::error_code ec; fs::remove(tmp, ec); return false; }
+    }
+    return ::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+static void takeSnapshot(const MappedFile& f, uint64_t listHash, const struct stat& st, Snapshot& s) {
+    memcpy(s.hdr.magic, "RLXSNP1", 8);
+    s.hdr.listHash  = listHash;
+    s.hdr.listMtime = (int64_t)st.st_mtime;
+    s.hdr.listSize  = (uint64_t)st.st_size;
+    s.hdr.taken     = (int64_t)time(nullptr);
+    forEachStanza(f, [&](const Stanza& st2) {
+        std::string_view name = st2.field("Package"), ver = st2.field("Version");
+        if (name.empty()) return true;
+        SnapRecord r{hashBytes(name.data(), name.size()), hashBytes(ver.data(), ver.size()),
+                     hashBytes(st2.b, (size_t)(st2.e - st2.b)), (uint32_t)s.strings.size(), 0};
+        s.strings.append(name.data(), name.size()).push_back('\0');
+        r.versionOff = (uint32_t)s.strings.size();
+        s.strings.append(ver.data(), ver.size()).push_back('\0');
+        s.recs.push_back(r);
+        return true;
+    });
+    std::sort(s.recs.begin(), s.recs.end(), [](const SnapRecord& a, const SnapRecord& b) {
+        return a.nameHash != b.nameHash ? a.nameHash < b.nameHash : a.versionHash < b.versionHash;
+    });
+    s.hdr.records     = (uint32_t)s.recs.size();
+    s.hdr.stringBytes = (uint32_t)s.strings.size();
+}
+
+struct IndexDelta {
+    bool                     known       = false;   // a previous snapshot exists
+    int                      newPackages = 0;
+    int                      newVersions = 0;
+    int                      removed     = 0;
+    int                      rebuilt     = 0;       // same version, different stanza
+    int64_t                  since       = 0;       // previous snapshot time
+    std::vector<std::string> lines;                 // drill-down
+};
+
+// One merge pass over two snapshots sorted by (name hash, version hash)
+static void diffSnapshots(const Snapshot& prev, const Snapshot& cur, IndexDelta& d,
+                          std::set<std::string>& seen) {
+    auto emit = [&](const std::string& line, int& counter) {
+        if (seen.insert(line).second) { d.lines.push_back(line); counter++; }
+    };
+    size_t i = 0, j = 0;
+    while (i < prev.recs.size() || j < cur.recs.size()) {
+        uint64_t name = j >= cur.recs.size()  ? prev.recs[i].nameHash
+                      : i >= prev.recs.size() ? cur.recs[j].nameHash
+                      : std::min(prev.recs[i].nameHash, cur.recs[j].nameHash);
+        size_t pi = i, cj = j;
+        while (i < prev.recs.size() && prev.recs[i].nameHash == name) i++;
+        while (j < cur.recs.size()  && cur.recs[j].nameHash  == name) j++;
+        if (pi == i) {                                  // name only in cur
+            for (size_t k = cj; k < j; k++)
+                emit("new        " + std::string(cur.str(cur.recs[k].nameOff)) + " " +
+                     cur.str(cur.recs[k].versionOff), d.newPackages);
+            continue;
+        }
+        if (cj == j) {                                  // name only in prev
+            emit("removed    " + std::string(prev.str(prev.recs[pi].nameOff)), d.removed);
+            continue;
+        }
+        // Both: versions of one package, each side sorted by version hash
+        const SnapRecord* newestPrev = &prev.recs[pi];
+        for (size_t k = pi + 1; k < i; k++)
+            if (DebVersion(prev.str(newestPrev->versionOff)) < DebVersion(prev.str(prev.recs[k].versionOff)))
+                newestPrev = &prev.recs[k];
+        size_t a = pi, b = cj;
+        while (b < j) {
+            if (a < i && prev.recs[a].versionHash < cur.recs[b].versionHash) { a++; continue; }
+            const SnapRecord& c = cur.recs[b++];
+            if (a < i && prev.recs[a].versionHash == c.versionHash) {
+                if (prev.recs[a].stanzaHash != c.stanzaHash)
+                    emit("rebuilt    " + std::string(cur.str(c.nameOff)) + " " + cur.str(c.versionOff), d.rebuilt);
+                a++;
+                continue;
+            }
+            emit("version    " + std::string(cur.str(c.nameOff)) + " " + prev.str(newestPrev->versionOff) +
+                 " -> " + cur.str(c.versionOff), d.newVersions);
+        }
+    }
+}
+
+// Bring the snapshots of `list` up to date; fills `d` from prev vs cur
+static bool updateListSnapshot(const std::string& list, const std::string& dir, IndexDelta& d,
+                               std::set<std::string>& seen) {
+    struct stat st;
+    if (stat(list.c_str(), &st) != 0) return false;
+    const std::string base = dir + "/" + fs::path(list).filename().string();
+    Snapshot cur, prev;
+    bool haveCur = readSnapshot(base + ".cur", cur);
+    bool fresh   = haveCur && cur.hdr.listMtime == (int64_t)st.st_mtime && cur.hdr.listSize == (uint64_t)st.st_size;
+    if (!fresh) {
+        MappedFile f(list);
+        if (!f.ok()) return false;
+        uint64_t h = hashBytes(f.data(), f.size());
+        if (haveCur && cur.hdr.listHash == h) {         // touched, not changed: restamp
+            cur.hdr.listMtime = (int64_t)st.st_mtime;
+            cur.hdr.listSize  = (uint64_t)st.st_size;
+        } else {
+            if (haveCur) ::rename((base + ".cur").c_str(), (base + ".prev").c_str());
+            cur = Snapshot{};
+            takeSnapshot(f, h, st, cur);
+        }
+        writeSnapshot(base + ".cur", cur);
+    }
+    if (!readSnapshot(base + ".prev", prev)) return true;   // first snapshot of this list
+    d.known = true;
+    d.since = std::max(d.since, prev.hdr.taken);
+    diffSnapshots(prev, cur, d, seen);
+    return true;
+}
+
+struct DeltaTable {
+    std::mutex                        mtx;
+    std::map<std::string, std::shared_ptr<const IndexDelta>> byKey;   // costKey()
+    std::atomic<uint64_t>             gen{0};
+    uint64_t                          reposGen = 0;   // main thread
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+static DeltaTable g_deltas;
+
+static void computeDeltasAsync(const std::vector<RepoEntry>& repos) {
+    if (g_deltas.cancel) g_deltas.cancel->store(true);
+    g_deltas.reposGen = g_reposGen;
+    std::vector<RepoEntry> enabled;
+    for (const auto& r : repos) if (r.enabled) enabled.push_back(r);
+    g_deltas.cancel = g_sched.submit(JobClass::Bulk, [enabled](JobCtx& ctx) {
+        const std::string dir = cacheDir() + "/snapshots";
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        std::map<std::string, std::shared_ptr<const IndexDelta>> byKey;
+        std::set<std::string> done;
+        for (const auto& r : enabled) {
+            std::string key = costKey(r);
+            if (!done.insert(key).second) continue;
+            IndexDelta d;
+            std::set<std::string> seen;                 // one line per package across archs
+            for (const auto& comp : splitWords(r.components))
+                for (const auto& a : entryArchitectures(r)) {
+                    if (!ctx.yield()) return;
+                    updateListSnapshot(packagesListPath(r, comp, a), dir, d, seen);
+                }
+            std::sort(d.lines.begin(), d.lines.end());
+            byKey[key] = std::make_shared<const IndexDelta>(std::move(d));
+        }
+        std::lock_guard<std::mutex> lk(g_deltas.mtx);
+        if (ctx.cancelled()) return;
+        g_deltas.byKey = std::move(byKey);
+        g_deltas.gen++;
+        g_uiEpoch++;
+    });
+}
+
+// Main loop: snapshot/diff once a (re)load has settled
+static void refreshIndexDeltas(bool loading) {
+    if (!loading && g_deltas.reposGen != g_reposGen) computeDeltasAsync(g_repos);
+}
+
+// apt update ran: take new snapshots on the next pass
+static void invalidateIndexDeltas() {
+    g_deltas.reposGen = 0;
+}
+
+static std::shared_ptr<const IndexDelta> indexDeltaFor(const RepoEntry& r) {
+    std::lock_guard<std::mutex> lk(g_deltas.mtx);
+    auto it = g_deltas.byKey.find(costKey(r));
+    return it == g_deltas.byKey.end() ? nullptr : it->second;
+}
+
+static std::string describeDelta(const IndexDelta& d) {
+    if (!d.known) return "first snapshot taken";
+    char since[32] = "";
+    time_t t = (time_t)d.since;
+    strftime(since, sizeof(since), "%Y-%m-%d %H:%M", localtime(&t));
+    return std::to_string(d.newPackages) + " new packages, " + std::to_string(d.newVersions) +
+           " new versions, " + std::to_string(d.removed) + " removed (since " + since + ")";
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13I — FRESHNESS / EXPIRY MONITOR
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  One background pass maps every enabled entry's cached Release/InRelease
+//  and reads Date and Valid-Until from its header, plus when the local copy
+//  was last refreshed.  The timestamps are kept; the state (expired /
+//  expiring / stale / ok) is derived from them against the clock, so the
+//  main loop re-classifies once a minute without touching the files.  An
+//  expired Valid-Until makes `apt update` fail for that source.
+//
+//  Staleness describes the local index, not the archive: a frozen suite
+//  (Ubuntu's release pocket, a third-party repo that rarely publishes)
+//  keeps an old Date forever and is still current.  apt stamps a list with
+//  the server's Last-Modified and leaves it alone on a 304, so the list
+//  mtime alone also ages; the newer of it and apt's update-success stamp
+//  is taken as the refresh time.
+
+enum class Freshness { Unknown, Ok, Stale, Expiring, Expired };
+
+struct FreshInfo {
+    int64_t   date       = -1;     // Release Date:
+    int64_t   validUntil = -1;     // Release Valid-Until: (-1: none)
+    int64_t   refreshed  = -1;     // local copy last refreshed (-1: no cached file)
+    Freshness state      = Freshness::Unknown;
+};
+
+static Freshness classifyFreshness(const FreshInfo& f, int64_t now) {
+    if (f.refreshed < 0) return Freshness::Unknown;
+    if (f.validUntil >= 0 && f.validUntil <= now) return Freshness::Expired;
+    if (f.validUntil >= 0 && f.validUntil - now <= int64_t(g_cfg.expiryWarnHours) * 3600)
+        return Freshness::Expiring;
+    if (now - f.refreshed > int64_t(g_cfg.staleDays) * 86400) return Freshness::Stale;
+    return Freshness::Ok;
+}
+
+static int64_t fileMtime(const std::string& path) {
+    struct stat st{};
+    return ::stat(path.c_str(), &st) == 0 ? (int64_t)st.st_mtime : -1;
+}
+
+// Date / Valid-Until from the header of Release or InRelease text
+static void releaseDatesFromText(std::string_view text, FreshInfo& out) {
+    const char* p   = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        if (!nl) nl = end;
+        std::string_view line(p, (size_t)(nl - p));
+        p = nl + 1;
+        if (line.rfind("MD5Sum:", 0) == 0 || line.rfind("SHA256:", 0) == 0) break;   // file lists follow
+        if (line.rfind("Date:", 0) == 0)
+            out.date = parseReleaseDate(std::string(line.substr(5)));
+        else if (line.rfind("Valid-Until:", 0) == 0)
+            out.validUntil = parseReleaseDate(std::string(line.substr(12)));
+    }
+}
+
+static bool readReleaseDates(const std::string& path, FreshInfo& out) {
+    MappedFile f(path);
+    if (!f.ok()) return false;
+    releaseDatesFromText(std::string_view(f.data(), f.size()), out);
+    return true;
+}
+
+struct FreshTable {
+    std::mutex                       mtx;
+    std::map<std::string, FreshInfo> byKey;        // listsPrefix()
+    std::atomic<uint64_t>            gen{0};       // bumped when any state changes
+    uint64_t                         reposGen = 0; // main thread
+    std::chrono::steady_clock::time_point lastClassify;
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+static FreshTable g_fresh;
+
+static void checkFreshnessAsync(const std::vector<RepoEntry>& repos) {
+    if (g_fresh.cancel) g_fresh.cancel->store(true);
+    g_fresh.reposGen = g_reposGen;
+    std::set<std::string> prefixes;
+    for (const auto& r : repos)
+        if (r.enabled && !r.uri.empty() && !r.suite.empty()) prefixes.insert(listsPrefix(r));
+    g_fresh.cancel = g_sched.submit(JobClass::Bulk, [prefixes](JobCtx& ctx) {
+        std::map<std::string, FreshInfo> byKey;
+        const int64_t now   = (int64_t)time(nullptr);
+        const int64_t stamp = fileMtime("/var/lib/apt/periodic/update-success-stamp");
+        for (const auto& prefix : prefixes) {
+            if (!ctx.yield()) return;
+            FreshInfo fi;
+            std::string path = prefix + "_InRelease";
+            if (!readReleaseDates(path, fi)) {
+                path = prefix + "_Release";
+                readReleaseDates(path, fi);
+            }
+            fi.refreshed = fileMtime(path);
+            if (fi.refreshed >= 0) fi.refreshed = std::max(fi.refreshed, stamp);
+            fi.state = classifyFreshness(fi, now);
+            byKey[prefix] = fi;
+        }
+        std::lock_guard<std::mutex> lk(g_fresh.mtx);
+        if (ctx.cancelled()) return;
+        g_fresh.byKey = std::move(byKey);
+        g_fresh.gen++;
+        g_uiEpoch++;
+    });
+}
+
+// Main loop: re-read after a (re)load; re-classify against the clock each minute
+static void refreshFreshness(bool loading) {
+    if (!loading && g_fresh.reposGen != g_reposGen) { checkFreshnessAsync(g_repos); return; }
+    auto nowSteady = std::chrono::steady_clock::now();
+    if (nowSteady - g_fresh.lastClassify < std::chrono::minutes(1)) return;
+    g_fresh.lastClassify = nowSteady;
+    const int64_t now = (int64_t)time(nullptr);
+    std::lock_guard<std::mutex> lk(g_fresh.mtx);
+    bool changed = false;
+    for (auto& kv : g_fresh.byKey) {
+        Freshness s = classifyFreshness(kv.second, now);
+        if (s != kv.second.state) { kv.second.state = s; changed = true; }
+    }
+    if (changed) { g_fresh.gen++; g_uiEpoch++; }
+}
+
+// apt update ran: read the new Release files on the next pass
+static void invalidateFreshness() {
+    g_fresh.reposGen = 0;
+}
+
+static bool freshnessFor(const RepoEntry& r, FreshInfo& out) {
+    if (!r.enabled) return false;
+    std::lock_guard<std::mutex> lk(g_fresh.mtx);
+    auto it = g_fresh.byKey.find(listsPrefix(r));
+    if (it == g_fresh.byKey.end()) return false;
+    out = it->second;
+    return true;
+}
+
+// Sort key for the "Fresh" sort mode: most urgent first
+static int freshnessRank(const RepoEntry& r) {
+    FreshInfo fi;
+    if (!freshnessFor(r, fi)) return 5;
+    switch (fi.state) {
+        case Freshness::Expired:  return 0;
+        case Freshness::Expiring: return 1;
+        case Freshness::Stale:    return 2;
+        case Freshness::Ok:       return 3;
+        default:                  return 4;
+    }
+}
+
+static std::string describeAge(int64_t secs) {
+    if (secs < 0) secs = -secs;
+    if (secs >= 2 * 86400) return std::to_string(secs / 86400) + " days";
+    if (secs >= 2 * 3600)  return std::to_string(secs / 3600) + " hours";
+    return std::to_string(secs / 60) + " min";
+}
+
+static std::string describeFreshness(const FreshInfo& f) {
+    const int64_t now = (int64_t)time(nullptr);
+    switch (f.state) {
+        case Freshness::Expired:  return "EXPIRED " + describeAge(now - f.validUntil) + " ago (apt update will fail)";
+        case Freshness::Expiring: return "expires in " + describeAge(f.validUntil - now);
+        case Freshness::Stale:    return "STALE: not refreshed for " + describeAge(now - f.refreshed);
+        case Freshness::Ok:
+            return "refreshed " + describeAge(now - f.refreshed) + " ago" +
+                   (f.date >= 0 ? ", published " + describeAge(now - f.date) + " ago" : "") +
+                   (f.validUntil >= 0 ? ", valid " + describeAge(f.validUntil - now) : "");
+        default:                  return "unknown (no cached Release)";
+    }
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13J — REMOTE INRELEASE CHECK (HTTP/1.1 conditional GET)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Each host's entries are checked over one pooled keep-alive connection: GET
+//  dists/<suite>/InRelease with If-Modified-Since set to the cached file's
+//  mtime (apt stamps list files with the server's Last-Modified) and the ETag
+//  seen last time.  304 means the local copy is current; a 200 carries the
+//  remote header, whose Date is compared with the local one.  Only the first
+//  8 KiB are requested — Date sits at the top of the file.  There is no TLS
+//  here, so https entries are reported as not checked.
+
+enum class RemoteState { Unknown, Current, Newer, Older, Moved, NotChecked, Failed };
+
+struct RemoteInfo {
+    RemoteState state      = RemoteState::Unknown;
+    int         status     = 0;         // HTTP status of the last exchange
+    int64_t     remoteDate = -1;        // Date: of the upstream InRelease
+    std::string detail;                 // error text or reason not checked
+};
+
+// Where the entry's InRelease lives upstream; flat repositories ("suite/")
+// keep it next to the suite path
+static std::string remoteInReleasePath(const RepoEntry& r) {
+    std::string path = r.uri;
+    auto sp = path.find("://");
+    if (sp != std::string::npos) path = path.substr(sp + 3);
+    auto slash = path.find('/');
+    path = slash == std::string::npos ? "/" : path.substr(slash);
+    if (path.back() != '/') path += '/';
+    if (!r.suite.empty() && r.suite.back() == '/')
+        return path + (r.suite == "/" || r.suite == "./" ? "" : r.suite) + "InRelease";
+    return path + "dists/" + r.suite + "/InRelease";
+}
+
+/* ─── ETag store: ~/.cache/relix/etags ──────────────────────────────────────
+ *
+ *  "<url> <local Date> <etag>" per line.  An ETag is only kept for a
+ *  response whose Date matched the local copy, and only sent while the local
+ *  Date is still the one it was recorded with — a 304 on it then really
+ *  means "same as what apt has".
+ * ─────────────────────────────────────────────────────────────────────────── */
+
+static std::string etagStorePath() { return cacheDir() + "/etags"; }
+
+static std::map<std::string, std::pair<int64_t, std::string>> readEtags() {
+    std::map<std::string, std::pair<int64_t, std::string>> out;
+    std::ifstream f(etagStorePath());
+    std::string url, etag;
+    int64_t date = 0;
+    while (f >> url >> date && std::getline(f >> std::ws, etag))
+        out[url] = { date, etag };
+    return out;
+}
+
+static void writeEtags(const std::map<std::string, std::pair<int64_t, std::string>>& tags) {
+    std::error_code ec;
+    fs::create_directories(cacheDir(), ec);
+    std::string tmp = etagStorePath() + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        for (const auto& kv : tags) f << kv.first << ' ' << kv.second.first << ' ' << kv.second.second << '\n';
+        if (!f) { fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, etagStorePath(), ec);
+}
+
+struct RemoteTarget {
+    std::string prefix;        // listsPrefix()
+    std::string path;          // request path
+    std::string url;           // ETag store key
+};
+
+struct RemoteTable {
+    std::mutex                        mtx;
+    std::map<std::string, RemoteInfo> byKey;        // listsPrefix()
+    std::atomic<uint64_t>             gen{0};
+    std::atomic<bool>                 running{false};
+    std::atomic<int>                  done{0}, total{0};
+    std::shared_ptr<std::atomic<bool>> cancel;
+};
+static RemoteTable g_remote;
+
+// Check one InRelease over `conn`; `tag` is the stored ETag entry (updated)
+static RemoteInfo checkRemoteInRelease(HttpConnection& conn, const RemoteTarget& t,
+                                       std::pair<int64_t, std::string>* tag, bool& tagChanged,
+                                       const std::atomic<bool>* cancel) {
+    RemoteInfo ri;
+    std::string local = t.prefix + "_InRelease";
+    struct stat st{};
+    bool haveLocal = ::stat(local.c_str(), &st) == 0;
+    if (!haveLocal) { local = t.prefix + "_Release"; haveLocal = ::stat(local.c_str(), &st) == 0; }
+    FreshInfo lf;
+    if (haveLocal) readReleaseDates(local, lf);
+
+    std::vector<std::pair<std::string, std::string>> hdrs = { {"Range", "bytes=0-8191"} };
+    if (haveLocal) {
+        hdrs.emplace_back("If-Modified-Since", httpDate((int64_t)st.st_mtime));
+        if (tag && lf.date >= 0 && tag->first == lf.date) hdrs.emplace_back("If-None-Match", tag->second);
+    }
+    HttpResponse resp;
+    std::string err, moved, path = t.path;
+    if (!requestFollowing(conn, "GET", path, hdrs, resp, err, moved, 5000, cancel)) {
+        ri.state  = RemoteState::Failed;
+        ri.detail = err;
+        return ri;
+    }
+    ri.status = resp.status;
+    if (!moved.empty()) {                  // apt follows it; we cannot (https)
+        ri.state  = RemoteState::Moved;
+        ri.detail = moved;
+        return ri;
+    }
+    if (resp.status == 304) {
+        ri.state      = RemoteState::Current;
+        ri.remoteDate = lf.date;
+        return ri;
+    }
+    if (resp.status != 200 && resp.status != 206) {
+        ri.state  = RemoteState::Failed;
+        ri.detail = "HTTP " + std::to_string(resp.status);
+        return ri;
+    }
+    FreshInfo rf;
+    releaseDatesFromText(resp.body, rf);
+    ri.remoteDate = rf.date;
+    if (!haveLocal)                           ri.state = RemoteState::Newer;
+    else if (rf.date >= 0 && lf.date >= 0)    ri.state = rf.date > lf.date ? RemoteState::Newer
+                                                       : rf.date < lf.date ? RemoteState::Older
+                                                                           : RemoteState::Current;
+    else {                                                         // no Date: fall back to Last-Modified
+        int64_t lm = parseReleaseDate(resp.header("last-modified"));
+        ri.state = lm > (int64_t)st.st_mtime ? RemoteState::Newer : RemoteState::Current;
+    }
+    std::string etag = resp.header("etag");
+    if (ri.state == RemoteState::Current && !etag.empty() && lf.date >= 0 && tag &&
+        (tag->first != lf.date || tag->second != etag)) {
+        *tag = { lf.date, etag };
+        tagChanged = true;
+    }
+    return ri;
+}
+
+// Check every enabled entry: each host's entries in turn over pooled
+// connections (normally one per host), up to 4 hosts at once.
+// `done(newer, checked, opened, reused)` runs on the main thread unless cancelled;
+// the last two count pool connections opened and reused by this check.
+static void startRemoteCheckJob(const std::vector<RepoEntry>& repos,
+                                std::function<void(int, int, int, int)> done) {
+    if (g_remote.cancel) g_remote.cancel->store(true);
+    std::map<std::string, std::vector<RemoteTarget>> byHost;       // "host:port" → targets
+    std::map<std::string, RemoteInfo> skipped;
+    std::set<std::string> seen;
+    for (const auto& r : repos) {
+        if (!r.enabled || r.uri.empty() || r.suite.empty()) continue;
+        std::string prefix = listsPrefix(r);
+        if (!seen.insert(prefix).second) continue;
+        if (r.uri.rfind("http://", 0) != 0) {
+            RemoteInfo ri;
+            ri.state  = RemoteState::NotChecked;
+            ri.detail = r.uri.rfind("https://", 0) == 0 ? "https (no TLS support)" : "not an http source";
+            skipped[prefix] = ri;
+            continue;
+        }
+        std::string host, port;
+        uriHostPort(r.uri, host, port);
+        RemoteTarget t{ prefix, remoteInReleasePath(r), "" };
+        t.url = "http://" + host + ":" + port + t.path;
+        byHost[host + ":" + port].push_back(std::move(t));
+    }
+    {
+        std::lock_guard<std::mutex> lk(g_remote.mtx);
+        g_remote.byKey = skipped;
+        g_remote.gen++;
+    }
+    int total = 0;
+    for (const auto& h : byHost) total += (int)h.second.size();
+    g_remote.done    = 0;
+    g_remote.total   = total;
+    g_remote.running = true;
+    g_remote.cancel = g_sched.submit(JobClass::Bulk, [byHost, done](JobCtx& ctx) {
+        auto tags = readEtags();
+        std::vector<std::pair<std::string, std::vector<RemoteTarget>>> hosts(byHost.begin(), byHost.end());
+        std::mutex mtx;                                            // tags, counters, tagChanged
+        std::atomic<size_t> next{0};
+        int newer = 0, checked = 0;
+        bool tagChanged = false;
+        const int openedBefore = g_httpPool.opened(), reusedBefore = g_httpPool.reused();
+        auto worker = [&] {
+            for (size_t i = next++; i < hosts.size() && !ctx.cancelled(); i = next++) {
+                auto colon = hosts[i].first.rfind(':');
+                std::string host = hosts[i].first.substr(0, colon), port = hosts[i].first.substr(colon + 1);
+                for (const auto& t : hosts[i].second) {
+                    std::pair<int64_t, std::string> tag{ -1, "" };
+                    {
+                        std::lock_guard<std::mutex> lk(mtx);
+                        auto it = tags.find(t.url);
+                        if (it != tags.end()) tag = it->second;
+                    }
+                    bool changed = false;
+                    RemoteInfo ri;
+                    if (auto conn = g_httpPool.acquire(host, port, ctx.cancel.get()))
+                        ri = checkRemoteInRelease(*conn, t, &tag, changed, ctx.cancel.get());
+                    else {
+                        ri.state  = RemoteState::Failed;
+                        ri.detail = "no free connection slot";
+                    }
+                    if (ctx.cancelled()) return;
+                    {
+                        std::lock_guard<std::mutex> lk(mtx);
+                        if (changed) { tags[t.url] = tag; tagChanged = true; }
+                        if (ri.state == RemoteState::Newer) newer++;
+                        if (ri.state != RemoteState::Failed) checked++;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lk(g_remote.mtx);
+                        g_remote.byKey[t.prefix] = ri;
+                        g_remote.gen++;
+                    }
+                    g_remote.done++;
+                    g_uiEpoch++;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < std::min<int>(4, (int)hosts.size()); t++) workers.emplace_back(worker);
+        worker();
+        for (auto& th : workers) th.join();
+        if (ctx.cancelled()) return;
+        if (tagChanged) writeEtags(tags);
+        int opened = g_httpPool.opened() - openedBefore, reused = g_httpPool.reused() - reusedBefore;
+        postToUi([done, newer, checked, opened, reused, cancel = ctx.cancel] {
+            if (cancel->load()) return;
+            g_remote.running = false;
+            done(newer, checked, opened, reused);
+        });
+    });
+}
+
+// F3: does a newly added entry exist upstream?  One-byte GET of its
+// InRelease, then Release, over the pool, following redirects as apt does.
+// A redirect to https:// cannot be followed here; apt will, so it is noted
+// rather than reported as a problem.  `done(suffix, ok)` runs on the main
+// thread with text to append to the "added" status.
+static void validateNewRepos(const std::vector<RepoEntry>& added,
+                             std::function<void(const std::string&, bool)> done) {
+    g_sched.submit(JobClass::Interactive, [added, done](JobCtx& ctx) {
+        std::string problem, movedTo;
+        int checked = 0, latency = -1;
+        for (const auto& r : added) {
+            if (r.uri.rfind("http://", 0) != 0 || r.suite.empty()) continue;
+            std::string host, port;
+            uriHostPort(r.uri, host, port);
+            auto conn = g_httpPool.acquire(host, port, ctx.cancel.get());
+            if (!conn) break;
+            const std::string inRelease = remoteInReleasePath(r);
+            std::string path = inRelease, moved;
+            HttpResponse resp;
+            std::string err;
+            auto t0 = SteadyClock::now();
+            bool ok = requestFollowing(*conn, "GET", path, { {"Range", "bytes=0-0"} }, resp, err, moved,
+                                       5000, ctx.cancel.get());
+            if (ok && moved.empty() && resp.status == 404) {
+                path = inRelease.substr(0, inRelease.size() - 9) + "Release";
+                ok = requestFollowing(*conn, "GET", path, { {"Range", "bytes=0-0"} }, resp, err, moved,
+                                      5000, ctx.cancel.get());
+            }
+            if (ctx.cancelled()) return;
+            if (!ok)                                         problem = host + " is unreachable (" + err + ")";
+            else if (!moved.empty())                         { movedTo = moved; continue; }
+            else if (resp.status != 200 && resp.status != 206) problem = "upstream answered HTTP " +
+                                                                 std::to_string(resp.status) + " for " + path;
+            if (!problem.empty()) break;
+            checked++;
+            latency = (int)std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::now() - t0).count();
+        }
+        postToUi([done, problem, movedTo, checked, latency] {
+            std::string note = movedTo.empty() ? "" : " (moved to " + movedTo + "; apt follows it)";
+            if (!problem.empty())  done(", but " + problem + " — check the URI and suite.", false);
+            else if (checked > 0)  done(" — suite found upstream (" + std::to_string(latency) + " ms)" + note + ".", true);
+            else if (!note.empty()) done(note + ".", true);
+            else                   done(" (not validated: no http:// entry).", true);
+        });
+    });
+}
+
+// apt update ran: earlier answers compared against the old lists
+static void invalidateRemoteCheck() {
+    if (g_remote.cancel) g_remote.cancel->store(true);
+    g_remote.running = false;
+    std::lock_guard<std::mutex> lk(g_remote.mtx);
+    g_remote.byKey.clear();
+    g_remote.gen++;
+}
+
+static bool remoteInfoFor(const RepoEntry& r, RemoteInfo& out) {
+    if (!r.enabled) return false;
+    std::lock_guard<std::mutex> lk(g_remote.mtx);
+    auto it = g_remote.byKey.find(listsPrefix(r));
+    if (it == g_remote.byKey.end()) return false;
+    out = it->second;
+    return true;
+}
+
+static std::string describeRemote(const RemoteInfo& ri) {
+    const int64_t now = (int64_t)time(nullptr);
+    std::string when = ri.remoteDate >= 0 ? " (published " + describeAge(now - ri.remoteDate) + " ago)" : "";
+    switch (ri.state) {
+        case RemoteState::Current:    return ri.status == 304 ? "up to date (304 Not Modified)" : "up to date" + when;
+        case RemoteState::Newer:      return "UPDATE AVAILABLE" + when;
+        case RemoteState::Older:      return "mirror is behind the local copy" + when;
+        case RemoteState::Moved:      return "moved to " + ri.detail + " (apt follows it; only http is checked here)";
+        case RemoteState::NotChecked: return "not checked: " + ri.detail;
+        case RemoteState::Failed:     return "check failed: " + ri.detail;
+        default:                      return "";
+    }
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 13K — MIRROR SPEED TEST (throughput history + suggestions)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Equivalent mirrors come from ~/.config/relix/mirrors: one group per line,
+//  whitespace-separated base URIs serving the same archive.  Every enabled
+//  http:// source is a candidate too.  `b` fetches the first 1 MiB of one of
+//  the entry's Packages.xz indexes from each candidate, four at a time, each
+//  fetch held to a fixed quarter of speedtest_kbps so a result never depends
+//  on how many others happened to run beside it.  A fetch that reaches its
+//  cap is only known to be at least that fast and is stored as capped.
+//  Samples are kept in ~/.cache/relix/mirror-speed; a mirror's score is the
+//  median of its last 5, and another mirror is only suggested once it has 2+
+//  samples and beats the current one by 25% — one lucky run does not flip
+//  the advice, and two mirrors that both hit the cap count as a tie.
+
+static std::string mirrorsPath() {
+    return (fs::path(configPath()).parent_path() / "mirrors").string();
+}
+
+static std::string speedHistoryPath() { return cacheDir() + "/mirror-speed"; }
+
+static std::string normMirror(std::string uri) {
+    while (!uri.empty() && uri.back() == '/') uri.pop_back();
+    return uri;
+}
+
+static std::vector<std::vector<std::string>> readMirrorGroups() {
+    std::vector<std::vector<std::string>> groups;
+    std::ifstream f(mirrorsPath());
+    std::string line;
+    while (std::getline(f, line)) {
+        line = trimStr(line.substr(0, line.find('#')));
+        std::vector<std::string> g;
+        for (const auto& w : splitWords(line)) g.push_back(normMirror(w));
+        if (g.size() > 1) groups.push_back(std::move(g));
+    }
+    return groups;
+}
+
+struct SpeedSample {
+    std::string uri;               // normMirror()
+    int64_t     when        = 0;
+    double      bytesPerSec = 0;   // 0: fetch failed
+    int         ttfbMs      = -1;  // request sent → first body byte
+    bool        capped      = false; // held at the per-fetch cap: "≥ bytesPerSec"
+};
+
+static std::vector<SpeedSample> readSpeedHistory() {
+    std::vector<SpeedSample> out;
+    std::ifstream f(speedHistoryPath());
+    std::string line;
+    while (std::getline(f, line)) {
+        std::istringstream ls(line);
+        SpeedSample s;
+        int capped = 0;
+        if (!(ls >> s.uri >> s.when >> s.bytesPerSec >> s.ttfbMs)) continue;
+        if (ls >> capped) s.capped = capped != 0;      // absent in older files
+        out.push_back(s);
+    }
+    return out;
+}
+
+// Append `fresh`, keeping the newest 8 samples per mirror
+static void saveSpeedHistory(const std::vector<SpeedSample>& fresh) {
+    std::vector<SpeedSample> all = readSpeedHistory();
+    all.insert(all.end(), fresh.begin(), fresh.end());
+    std::map<std::string, int> kept;
+    std::vector<SpeedSample> out;
+    for (auto it = all.rbegin(); it != all.rend(); ++it)
+        if (kept[it->uri]++ < 8) out.push_back(*it);
+    std::reverse(out.begin(), out.end());
+    std::error_code ec;
+    fs::create_directories(cacheDir(), ec);
+    std::string tmp = speedHistoryPath() + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream f(tmp, std::ios::trunc);
+        for (const auto& s : out)
+            f << s.uri << ' ' << s.when << ' ' << (uint64_t)s.bytesPerSec << ' ' << s.ttfbMs << ' '
+              << (s.capped ? 1 : 0) << '\n';
+        if (!f) { fs::remove(tmp, ec); return; }
+    }
+    fs::rename(tmp, speedHistoryPath(), ec);
+}
+
+struct MirrorScore {
+    double median  = 0;       // bytes/s over the last 5 samples
+    int    samples = 0;
+    double last    = 0;       // most recent sample
+    int    ttfbMs  = -1;      // of the most recent sample
+    bool   capped  = false;   // the median sample(s) hit the cap: a lower bound
+};
+
+static std::map<std::string, MirrorScore> scoreMirrors(const std::vector<SpeedSample>& hist) {
+    std::map<std::string, std::vector<const SpeedSample*>> byUri;
+    for (const auto& s : hist) byUri[s.uri].push_back(&s);
+    std::map<std::string, MirrorScore> out;
+    for (const auto& kv : byUri) {
+        const auto& v = kv.second;
+        std::vector<std::pair<double, bool>> recent;
+        for (size_t i = v.size() > 5 ? v.size() - 5 : 0; i < v.size(); i++)
+            recent.emplace_back(v[i]->bytesPerSec, v[i]->capped);
+        std::sort(recent.begin(), recent.end());
+        MirrorScore& sc = out[kv.first];
+        const size_t mid = recent.size() / 2;
+        sc.samples = (int)recent.size();
+        if (recent.size() % 2) {
+            sc.median = recent[mid].first;
+            sc.capped = recent[mid].second;
+        } else {
+            sc.median = (recent[mid - 1].first + recent[mid].first) / 2;
+            sc.capped = recent[mid - 1].second && recent[mid].second;
+        }
+        sc.last    = v.back()->bytesPerSec;
+        sc.ttfbMs  = v.back()->ttfbMs;
+    }
+    return out;
+}
+
+struct MirrorSuggestion {
+    std::string to;
+    double      fromBps = 0, toBps = 0;
+    bool        toCapped = false;   // toBps is a lower bound
+};
+
+struct SpeedTable {
+    std::mutex                              mtx;
+    std::map<std::string, MirrorScore>      scores;       // normMirror()
+    std::map<std::string, MirrorSuggestion> suggestions;  // normMirror(entry uri) → faster mirror
+    std::atomic<uint64_t>                   gen{0};
+    std::atomic<bool>                       running{false};
+    std::atomic<int>                        done{0}, total{0};
+    uint64_t                                reposGen = 0;  // main thread
+    std::shared_ptr<std::atomic<bool>>      cancel;
+};
+static SpeedTable g_speed;
+
+// Best mirror per group from the stored history, with hysteresis.  Capped
+// scores are lower bounds: two of them are a tie, and a member whose own
+// score is capped is never told to move.
+static void rebuildMirrorAdvice() {
+    auto scores = scoreMirrors(readSpeedHistory());
+    std::map<std::string, MirrorSuggestion> sugg;
+    for (const auto& group : readMirrorGroups()) {
+        const std::string* best = nullptr;
+        for (const auto& m : group) {
+            auto it = scores.find(m);
+            if (it == scores.end() || it->second.samples < 2 || it->second.median <= 0) continue;
+            const MirrorScore* b = best ? &scores[*best] : nullptr;
+            if (!b || (!(b->capped && it->second.capped) && it->second.median > b->median)) best = &m;
+        }
+        if (!best) continue;
+        const MirrorScore bestSc = scores[*best];
+        for (const auto& m : group) {
+            if (m == *best) continue;
+            auto it = scores.find(m);
+            double cur = it == scores.end() ? 0 : it->second.median;
+            if (it != scores.end() && (it->second.capped || bestSc.median < cur * 1.25)) continue;
+            sugg[m] = { *best, cur, bestSc.median, bestSc.capped };
+        }
+    }
+    std::lock_guard<std::mutex> lk(g_speed.mtx);
+    g_speed.scores      = std::move(scores);
+    g_speed.suggestions = std::move(sugg);
+    g_speed.gen++;
+}
+
+// Main loop: re-read history and mirror groups after a (re)load
+static void refreshMirrorAdvice(bool loading) {
+    if (loading || g_speed.reposGen == g_reposGen) return;
+    g_speed.reposGen = g_reposGen;
+    rebuildMirrorAdvice();
+}
+
+struct SpeedCandidate {
+    std::string base;          // normMirror()
+    std::string suffix;        // index path below the base
+};
+
+// Each enabled http:// source and the members of its mirror group, with the
+// Packages.xz path of the first entry that uses it
+static std::vector<SpeedCandidate> speedCandidates(const std::vector<RepoEntry>& repos) {
+    auto groups = readMirrorGroups();
+    std::map<std::string, std::string> suffixOf;
+    std::vector<std::string> order;
+    auto add = [&](const std::string& base, const std::string& suffix) {
+        if (suffixOf.emplace(base, suffix).second) order.push_back(base);
+    };
+    for (const auto& r : repos) {
+        if (!r.enabled || r.uri.rfind("http://", 0) != 0 || r.suite.empty()) continue;
+        auto comps = splitWords(r.components);
+        std::string suffix;
+        if (r.suite.back() == '/')
+            suffix = (r.suite == "./" || r.suite == "/" ? "" : r.suite) + "Packages.xz";
+        else if (!comps.empty())
+            suffix = "dists/" + r.suite + "/" + comps[0] + "/binary-" + entryArchitectures(r)[0] + "/Packages.xz";
+        else continue;
+        std::string base = normMirror(r.uri);
+        add(base, suffix);
+        for (const auto& g : groups)
+            if (std::find(g.begin(), g.end(), base) != g.end())
+                for (const auto& m : g)
+                    if (m.rfind("http://", 0) == 0) add(m, suffix);
+    }
+    std::vector<SpeedCandidate> out;
+    for (const auto& b : order) out.push_back({ b, suffixOf[b] });
+    return out;
+}
+
+struct SpeedResult {
+    SpeedCandidate cand;
+    SpeedSample    sample;
+    uint64_t       bytes = 0;
+    std::string    error;
+    bool           local = false;   // never reached the mirror: no sample stored
+};
+
+// `done(results)` runs on the main thread unless cancelled
+static void startSpeedTestJob(const std::vector<SpeedCandidate>& cands,
+                              std::function<void(const std::vector<SpeedResult>&)> done) {
+    if (g_speed.cancel) g_speed.cancel->store(true);
+    g_speed.done    = 0;
+    g_speed.total   = (int)cands.size();
+    g_speed.running = true;
+    static constexpr int k_workers = 4;
+    const double fetchCapBps = double(g_cfg.speedtestKbps) * 1024 / k_workers;
+    g_speed.cancel = g_sched.submit(JobClass::Bulk, [cands, done, fetchCapBps](JobCtx& ctx) {
+        static constexpr uint64_t k_rangeBytes = 1u << 20;
+        static constexpr auto     k_budget     = std::chrono::seconds(8);
+        std::vector<SpeedResult> results(cands.size());
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t i = next++; i < cands.size() && !ctx.cancelled(); i = next++) {
+                SpeedResult& res = results[i];
+                res.cand        = cands[i];
+                res.sample.uri  = cands[i].base;
+                res.sample.when = (int64_t)time(nullptr);
+                std::string host, port;
+                uriHostPort(cands[i].base, host, port);
+                std::string path = cands[i].base.substr(7);
+                auto slash = path.find('/');
+                path = (slash == std::string::npos ? "" : path.substr(slash)) + "/" + cands[i].suffix;
+
+                auto conn = g_httpPool.acquire(host, port, ctx.cancel.get());
+                if (!conn) {
+                    res.error = "no connection slot";
+                    res.local = true;
+                    g_speed.done++;
+                    continue;
+                }
+                auto t0 = SteadyClock::now();
+                SteadyClock::time_point first{};
+                // Count bytes and hold this fetch to its fixed cap
+                HttpConnection::BodySink sink = [&](const char*, size_t n) {
+                    auto now = SteadyClock::now();
+                    if (res.bytes == 0) first = now;
+                    res.bytes += n;
+                    auto due = first + std::chrono::duration_cast<SteadyClock::duration>(
+                                           std::chrono::duration<double>(double(res.bytes) / fetchCapBps));
+                    while (SteadyClock::now() < due && !ctx.cancelled())
+                        std::this_thread::sleep_for(std::min<SteadyClock::duration>(
+                            due - SteadyClock::now(), std::chrono::milliseconds(50)));
+                    return res.bytes < k_rangeBytes && SteadyClock::now() - first < k_budget && !ctx.cancelled();
+                };
+                HttpResponse resp;
+                std::string err;
+                bool ok = conn->request("GET", path, { {"Range", "bytes=0-" + std::to_string(k_rangeBytes - 1)} },
+                                        resp, err, 20000, ctx.cancel.get(), sink);
+                auto end = SteadyClock::now();
+                if (ctx.cancelled()) { res.local = true; break; }
+                if (!ok && err == "stopped" && res.bytes > 0) ok = true;    // our own early stop
+                if (ok && resp.status != 200 && resp.status != 206) { ok = false; err = "HTTP " + std::to_string(resp.status); }
+                if (ok && res.bytes > 0) {
+                    double secs = std::max(1e-3, std::chrono::duration<double>(end - first).count());
+                    res.sample.bytesPerSec = double(res.bytes) / secs;
+                    res.sample.capped = res.sample.bytesPerSec >= fetchCapBps * 0.9;   // throttled, not measured
+                    res.sample.ttfbMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(first - t0).count();
+                } else {
+                    res.error = ok ? "empty response" : err;
+                }
+                g_speed.done++;
+                g_uiEpoch++;
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < std::min<int>(k_workers, (int)cands.size()); t++) workers.emplace_back(worker);
+        worker();
+        for (auto& th : workers) th.join();
+        if (ctx.cancelled()) return;
+        std::vector<SpeedSample> samples;
+        for (const auto& r : results)
+            if (!r.local) samples.push_back(r.sample);
+        saveSpeedHistory(samples);
+        rebuildMirrorAdvice();
+        g_uiEpoch++;
+        postToUi([done, results = std::move(results), cancel = ctx.cancel] {
+            if (cancel->load()) return;
+            g_speed.running = false;
+            done(results);
+        });
+    });
+}
+
+static bool mirrorSuggestionFor(const RepoEntry& r, MirrorSuggestion& out) {
+    std::lock_guard<std::mutex> lk(g_speed.mtx);
+    auto it = g_speed.suggestions.find(normMirror(r.uri));
+    if (it == g_speed.suggestions.end()) return false;
+    out = it->second;
+    return true;
+}
+
+static bool mirrorScoreFor(const std::string& uri, MirrorScore& out) {
+    std::lock_guard<std::mutex> lk(g_speed.mtx);
+    auto it = g_speed.scores.find(normMirror(uri));
+    if (it == g_speed.scores.end()) return false;
+    out = it->second;
+    return true;
+}
+
+static std::string humanRate(double bps, bool capped = false) {
+    return bps <= 0 ? "failed" : (capped ? ">= " : "") + humanBytes((uint64_t)bps) + "/s";
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 14 — UI STATE
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+static int         g_selected    = 0;
+static int         g_scrollOff   = 0;
+static std::string g_status;
+static bool        g_statusErr   = false;
+static bool        g_searchMode  = false;
+static bool        g_deltaColumn = false;   // count column: index delta instead of upgrades
+static RepoMeta    g_curMeta;
+static std::string g_curMetaKey;            // metaKey() of the entry g_curMeta describes
+static uint64_t    g_metaEpoch   = 0;       // bumped whenever g_curMeta is replaced
+static bool        g_metaShown   = false;
+static std::string g_renderStats;           // native renderer byte counts (header)
+
+// Modal popup driven by the main event loop (implementations in Section 17)
+struct Dialog {
+    virtual ~Dialog() = default;
+    virtual void draw() = 0;                 // paint + wnoutrefresh, no doupdate
+    virtual bool handleKey(int ch) = 0;      // true when the dialog is finished
+    virtual void finish() {}                 // continuation, runs after close
+    virtual bool wantsCursor() const { return false; }
+};
+static std::unique_ptr<Dialog> g_dialog;     // at most one popup open
+
+static void setStatus(const std::string& msg, bool isErr = false) {
+    g_status    = msg;
+    g_statusErr = isErr;
+}
+
+static int listHeight();   // Section 15
+
+static void clampSelection() {
+    int sz = (int)g_filtered.size();
+    if (sz == 0) { g_selected = 0; g_scrollOff = 0; return; }
+    g_selected = std::max(0, std::min(g_selected, sz - 1));
+    int listH  = listHeight();
+    if (g_scrollOff > g_selected)              g_scrollOff = g_selected;
+    if (g_selected >= g_scrollOff + listH)     g_scrollOff = g_selected - listH + 1;
+    g_scrollOff = std::max(0, g_scrollOff);
+}
+
+// Handy accessor: index into g_repos for the currently selected filtered entry
+static int currentRepoIndex() {
+    if (g_filtered.empty()) return -1;
     return g_filtered[g_selected];
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- *  SECTION 15 — LAYOUT CONSTANTS (computed at runtime)
+ *  SECTION 15 — LAYOUT (cached geometry, recomputed on resize)
  * ═══════════════════════════════════════════════════════════════════════════ */
 //
 //  Row 0       : header
 //  Row 1       : separator
 //  Rows 2..H-5 : list pane (left) + detail pane (right)
 //  Row H-4     : separator
-//  Row H-3     : detail line 1 (file)
+//  Row H-3     : info line (spare)
 //  Row H-2     : status bar
 //  Row H-1     : footer / key hints
 //
 //  Cols 0..splitCol-1 : list pane
 //  Col  splitCol      : vertical separator │
 //  Cols splitCol+1..  : detail pane
+//
+//  computeLayout() runs once at startup and once per settled resize; draw
+//  functions read g_layout instead of re-deriving geometry from LINES/COLS.
+
+struct Rect { int y = 0, x = 0, h = 0, w = 0; };
+
+struct Layout {
+    int  lines = 0, cols = 0;   // terminal size this layout was built for
+    Rect header, list, detail, status, footer;
+    int  splitCol   = 0;        // vertical separator column
+    int  sepTop     = 1;        // horizontal separator rows
+    int  sepBottom  = 0;
+    int  rowTextW   = 0;        // list row text width (after the 1-col margin)
+    int  rowTruncW  = 0;        // columns kept when a row needs "..." appended
+    int  countColX  = 0;        // upgrade-count column, relative to the list pane
+    int  countColW  = 0;
+    int  detailValX = 0;        // detail pane value column
+    int  detailValW = 0;
+    int  statusMsgW = 0;        // room for the status message after the counter
+    uint64_t generation = 0;    // bumped on every recompute (render caches key on it)
+};
+static Layout g_layout;
+
+static constexpr int k_resizeDebounceMs = 60;
+static bool                    g_resizePending = false;
+static SteadyClock::time_point g_resizeAt;
+
+static void createPanes();   // Section 16
+
+static void computeLayout() {
+    Layout l;
+    l.lines = LINES;
+    l.cols  = COLS;
+    l.generation = g_layout.generation + 1;
+
+    int listW     = std::max(20, l.cols * 60 / 100);  // 60% width
+    int paneH     = std::max(1, l.lines - 6);
+    l.splitCol    = listW;
+    l.sepBottom   = std::max(2, l.lines - 4);
+    l.header      = {0, 0, 1, l.cols};
+    l.list        = {2, 0, paneH, listW};
+    l.detail      = {2, listW + 1, paneH, std::max(0, l.cols - listW - 1)};
+    l.status      = {std::max(0, l.lines - 2), 0, 1, l.cols};
+    l.footer      = {std::max(0, l.lines - 1), 0, 1, l.cols};
+    l.countColW   = listW >= 30 ? 6 : 0;             // " +999 " (last col under scrollbar)
+    l.rowTextW    = std::max(1, listW - 1 - l.countColW);
+    l.rowTruncW   = std::max(0, l.rowTextW - 3);
+    l.countColX   = 1 + l.rowTextW;
+    l.detailValX  = l.detail.x + 13;
+    l.detailValW  = std::max(0, l.detail.w - 14);
+    l.statusMsgW  = std::max(0, l.cols - 20);
+    g_layout = l;
+    createPanes();
+}
+
+// KEY_RESIZE arrives repeatedly while a window is being dragged; only the
+// last one, once quiet for k_resizeDebounceMs, triggers a relayout.
+static void noteResize() {
+    g_resizePending = true;
+    g_resizeAt      = SteadyClock::now();
+}
+
+static void invalidateScreen();   // Section 15A
+
+// Returns true if the layout changed this call
+static bool applyPendingResize() {
+    if (!g_resizePending) return false;
+    if (SteadyClock::now() - g_resizeAt < std::chrono::milliseconds(k_resizeDebounceMs))
+        return false;
+    g_resizePending = false;
+    computeLayout();
+    clampSelection();
+    invalidateScreen();      // terminal content is unknown after a resize
+    return true;
+}
+
+static int listHeight() { return g_layout.list.h; }
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 15A — NATIVE TERMINAL RENDERER (optional, ncursesw + UTF-8 only)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  With renderer=native, frames are still composed with the ncurses window
+//  API and wnoutrefresh(), but doupdate() is never called.  present() reads
+//  the composed virtual screen (newscr) into a back buffer, diffs it against
+//  the front buffer of what the terminal shows, and writes only the changed
+//  runs, wrapped in DEC synchronized-update mode (?2026) so slow links never
+//  show a half-drawn frame.  Terminals without 2026 ignore the sequence.
+//  Anything else (ncurses build without wide API, non-UTF-8 locale) keeps
+//  the ncurses doupdate() path.
+
+class NativeRenderer {
+public:
+    static bool available() {
+#if NCURSES_WIDECHAR && defined(RELIX_HAVE_NCURSESW)
+        const char* cs = nl_langinfo(CODESET);
+        return cs && (strcmp(cs, "UTF-8") == 0 || strcmp(cs, "utf8") == 0);
+#else
+        return false;
+#endif
+    }
+
+    bool active() const { return m_active; }
+    void enable()       { m_active = available(); m_full = true; }
 
-static int listPaneW()  { return std::max(20, COLS * 60 / 100); }  // 60% width
-static int detailPaneX(){ return listPaneW() + 1; }
-static int detailPaneW(){ return std::max(0, COLS - detailPaneX()); }
-static int listHeight() { return std::max(1, LINES - 5); }
+    // Terminal content is unknown (resize, shell-out): repaint everything
+    void invalidate()   { m_full = true; }
+
+    // Rows [top, top+height) moved up by `delta` lines (down if negative)
+    // since the last frame.  present() shifts them with a terminal scroll
+    // region instead of rewriting them.
+    void hintScroll(int top, int height, int delta) {
+        m_scrollTop = top; m_scrollH = height; m_scrollDelta = delta;
+    }
+
+    size_t lastFrameBytes() const { return m_lastBytes; }
+    size_t framesSent()     const { return m_frames; }
+    size_t avgFrameBytes()  const { return m_frames ? m_totalBytes / m_frames : 0; }
+
+    // Replaces doupdate(): diff newscr against the front buffer and emit
+    void present(bool showCursor) {
+#if NCURSES_WIDECHAR && defined(RELIX_HAVE_NCURSESW)
+        int rows = getmaxy(newscr), cols = getmaxx(newscr);
+        if (rows != m_rows || cols != m_cols) {
+            m_rows = rows; m_cols = cols; m_full = true;
+            m_front.assign((size_t)rows * (size_t)cols, Cell{});
+        }
+        m_back.assign((size_t)rows * (size_t)cols, Cell{});
+        capture();
+
+        std::string out;
+        out.reserve(m_full ? (size_t)rows * (size_t)cols * 2 : 256);
+        m_curSgr.clear();
+        if (m_full) out += "\x1b[0m\x1b[2J";
+        else        applyScrollHint(out);
+        m_scrollDelta = 0;
+
+        for (int y = 0; y < rows; y++) {
+            int x = 0;
+            while (x < cols) {
+                if (!m_full && m_back[idx(y, x)] == m_front[idx(y, x)]) { x++; continue; }
+                // Start of a changed run; extend it across short clean gaps,
+                // which is cheaper than another cursor-position sequence.
+                int end = x + 1, clean = 0;
+                for (int k = x + 1; k < cols; k++) {
+                    if (m_full || !(m_back[idx(y, k)] == m_front[idx(y, k)])) { end = k + 1; clean = 0; }
+                    else if (++clean > k_gapMerge) break;
+                }
+                out += "\x1b[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + "H";
+                for (int k = x; k < end; k++) {
+                    const Cell& c = m_back[idx(y, k)];
+                    if (c.text.empty()) continue;      // right half of a wide char
+                    out += sgr(c);
+                    out += c.text;
+                }
+                x = end;
+            }
+        }
+
+        if (out.empty() && !showCursor) return;   // nothing changed: zero bytes
+        out += "\x1b[0m";
+        if (showCursor) {
+            int cy = getcury(newscr), cx = getcurx(newscr);
+            out += "\x1b[" + std::to_string(cy + 1) + ";" + std::to_string(cx + 1) + "H";
+        }
+        std::string frame = "\x1b[?2026h" + out + "\x1b[?2026l";
+        writeAll(frame);
+        m_front.swap(m_back);
+        m_full = false;
+        m_lastBytes   = frame.size();
+        m_totalBytes += frame.size();
+        m_frames++;
+#else
+        (void)showCursor;
+        doupdate();
+#endif
+    }
+
+private:
+    struct Cell {
+        std::string text;      // UTF-8; empty for the right half of a wide char
+        short       pair  = 0;
+        attr_t      attrs = 0;
+        bool operator==(const Cell& o) const {
+            return pair == o.pair && attrs == o.attrs && text == o.text;
+        }
+    };
+
+    static constexpr int k_gapMerge = 4;
+
+    size_t idx(int y, int x) const { return (size_t)y * (size_t)m_cols + (size_t)x; }
+
+    // Scroll the hinted region on the terminal (DECSTBM + SU/SD) and shift
+    // the front buffer to match, so the diff only sees the exposed rows and
+    // whatever really changed.  Scroll regions are full width, so rows the
+    // list shares with the detail pane are simply re-diffed.
+    void applyScrollHint(std::string& out) {
+        int d = m_scrollDelta, top = m_scrollTop, h = m_scrollH;
+        if (d == 0 || h < 2 || std::abs(d) >= h / 2 || top < 0 || top + h > m_rows) return;
+        out += "\x1b[0m";    // exposed lines take the default background
+        out += "\x1b[" + std::to_string(top + 1) + ";" + std::to_string(top + h) + "r";
+        out += "\x1b[" + std::to_string(std::abs(d)) + (d > 0 ? "S" : "T");
+        out += "\x1b[r";     // reset region (homes the cursor; we position absolutely)
+        const Cell blank{" ", 0, 0};
+        if (d > 0) {
+            for (int y = top; y < top + h; y++)
+                for (int x = 0; x < m_cols; x++)
+                    m_front[idx(y, x)] = (y + d < top + h) ? m_front[idx(y + d, x)] : blank;
+        } else {
+            for (int y = top + h - 1; y >= top; y--)
+                for (int x = 0; x < m_cols; x++)
+                    m_front[idx(y, x)] = (y + d >= top) ? m_front[idx(y + d, x)] : blank;
+        }
+    }
+
+#if NCURSES_WIDECHAR && defined(RELIX_HAVE_NCURSESW)
+    // Box-drawing glyphs for the ACS characters relix uses
+    static const char* acsGlyph(wchar_t c) {
+        switch (c) {
+            case 'q': return "─"; case 'x': return "│";
+            case 'l': return "┌"; case 'k': return "┐";
+            case 'm': return "└"; case 'j': return "┘";
+            case 'w': return "┬"; case 'v': return "┴";
+            case 't': return "├"; case 'u': return "┤";
+            case 'n': return "┼"; case '0': return "█";
+            case 'a': return "▒"; case '~': return "·";
+            default:  return nullptr;
+        }
+    }
+
+    void capture() {
+        for (int y = 0; y < m_rows; y++) {
+            for (int x = 0; x < m_cols; x++) {
+                cchar_t cc;
+                if (mvwin_wch(newscr, y, x, &cc) == ERR) continue;
+                wchar_t wch[CCHARW_MAX + 1] = {};
+                attr_t  attrs = 0;
+                short   pair  = 0;
+                getcchar(&cc, wch, &attrs, &pair, nullptr);
+                Cell& c = m_back[idx(y, x)];
+                c.pair  = pair;
+                c.attrs = attrs & (A_BOLD | A_DIM | A_REVERSE | A_UNDERLINE);
+                const char* acs = (attrs & A_ALTCHARSET) ? acsGlyph(wch[0]) : nullptr;
+                if (acs) { c.text = acs; continue; }
+                char mb[MB_LEN_MAX * (CCHARW_MAX + 1)];
+                std::mbstate_t st{};
+                size_t n = 0;
+                for (int i = 0; i < CCHARW_MAX && wch[i]; i++) {
+                    size_t k = std::wcrtomb(mb + n, wch[i], &st);
+                    if (k != (size_t)-1) n += k;
+                }
+                c.text = n ? std::string(mb, n) : " ";
+                if (wcwidth(wch[0]) == 2 && x + 1 < m_cols) {
+                    m_back[idx(y, x + 1)] = Cell{std::string(), pair, c.attrs};
+                    x++;
+                }
+            }
+        }
+    }
+#endif
+
+    // SGR for a cell, emitted only when it differs from the current one
+    std::string sgr(const Cell& c) {
+        short fg = -1, bg = -1;
+        if (c.pair > 0) pair_content(c.pair, &fg, &bg);
+        std::string s = "\x1b[0";
+        if (c.attrs & A_BOLD)      s += ";1";
+        if (c.attrs & A_DIM)       s += ";2";
+        if (c.attrs & A_UNDERLINE) s += ";4";
+        if (c.attrs & A_REVERSE)   s += ";7";
+        if (fg >= 0 && fg < 8) s += ";" + std::to_string(30 + fg);
+        if (bg >= 0 && bg < 8) s += ";" + std::to_string(40 + bg);
+        s += "m";
+        if (s == m_curSgr) return {};
+        m_curSgr = s;
+        return s;
+    }
+
+    static void writeAll(const std::string& s) {
+        size_t off = 0;
+        while (off < s.size()) {
+            ssize_t n = ::write(STDOUT_FILENO, s.data() + off, s.size() - off);
+            if (n < 0) { if (errno == EINTR) continue; return; }
+            off += (size_t)n;
+        }
+    }
+
+    bool              m_active = false;
+    bool              m_full   = true;
+    int               m_rows = 0, m_cols = 0;
+    std::vector<Cell> m_front, m_back;
+    std::string       m_curSgr;
+    size_t            m_lastBytes = 0, m_totalBytes = 0, m_frames = 0;
+    int               m_scrollTop = 0, m_scrollH = 0, m_scrollDelta = 0;
+};
+static NativeRenderer g_native;
+
+// Flush the composed frame through whichever backend is active
+static void presentFrame(bool showCursor) {
+    if (g_native.active()) g_native.present(showCursor);
+    else                   doupdate();
+}
+
+// The terminal no longer shows what we think it does
+static void invalidateScreen() {
+    clearok(curscr, TRUE);
+    g_native.invalidate();
+}
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 16 — DRAWING
@@ -907,8 +5646,69 @@ static int listHeight() { return std::max(1, LINES - 5); }
  *   • Remove the redundant double-redraw in the event loop.
  * ─────────────────────────────────────────────────────────────────────────── */
 
+/* ─── per-pane windows ───────────────────────────────────────────────────────
+ *
+ *  Header, list, detail, status and footer each own a WINDOW; stdscr only
+ *  carries the separator frame.  A pane is re-rendered only when the state
+ *  it was drawn from (its key) changes, and every pane is wnoutrefresh()ed
+ *  into the virtual screen independently.  Closing a popup touches just the
+ *  rows it covered in the panes beneath it.
+ * ─────────────────────────────────────────────────────────────────────────── */
+
+struct Pane {
+    WINDOW*     win = nullptr;
+    std::string key;      // state the current contents were drawn from
+};
+static Pane     g_paneHeader, g_paneList, g_paneDetail, g_paneStatus, g_paneFooter;
+static uint64_t g_frameGen = 0;   // layout generation the separators were drawn for
+static int      g_frameTheme = -1;
+
+static Pane* const k_panes[] = { &g_paneHeader, &g_paneList, &g_paneDetail,
+                                 &g_paneStatus, &g_paneFooter };
+
+static void createPanes() {
+    const Layout& L = g_layout;
+    auto make = [](Pane& p, const Rect& r) {
+        if (p.win) delwin(p.win);
+        p.win = newwin(std::max(1, r.h), std::max(1, r.w), r.y, r.x);
+        p.key.clear();
+    };
+    make(g_paneHeader, L.header);
+    make(g_paneList,   L.list);
+    idlok(g_paneList.win, TRUE);   // drawList() wscrl()s the list on scroll
+    make(g_paneDetail, {L.detail.y, L.detail.x, L.detail.h, std::max(1, L.detail.w)});
+    make(g_paneStatus, L.status);
+    make(g_paneFooter, L.footer);
+    g_frameGen = 0;
+}
+
+// Forget what a popup covered: touch the rows of every window beneath it
+static void invalidateRect(int y, int x, int h, int w) {
+    auto touch = [&](WINDOW* win) {
+        if (!win) return;
+        int wy = getbegy(win), wx = getbegx(win), wh = getmaxy(win), ww = getmaxx(win);
+        if (x >= wx + ww || x + w <= wx) return;
+        int top = std::max(y, wy), bot = std::min(y + h, wy + wh);
+        if (top < bot) touchline(win, top - wy, bot - top);
+    };
+    touch(stdscr);
+    for (Pane* p : k_panes) touch(p->win);
+}
+
+// True if the pane must be re-rendered; erases it and records the new key
+static bool paneNeedsDraw(Pane& p, const std::string& key) {
+    if (p.key == key) return false;
+    p.key = key;
+    werase(p.win);
+    return true;
+}
+
+// Common prefix for pane keys: anything that changes every pane
+static std::string baseKey() {
+    return std::to_string(g_layout.generation) + "/" + std::to_string(g_cfg.themeIndex) + "/";
+}
+
 static void drawHeader() {
-    attron(COLOR_PAIR(CP_HEADER) | A_BOLD);
     std::string title = " Relix - APT Repository Manager";
     if (g_readOnly) title += "  [READ-ONLY]";
     title += "   OS: " + g_os.id;
@@ -917,37 +5717,166 @@ static void drawHeader() {
     title += "   Theme: ";
     title += k_themes[g_cfg.themeIndex].name;
     title += "   Sort: ";
-    static const char* sortNames[] = {"File","Status","Alpha"};
+    static const char* sortNames[] = {"File","Status","Alpha","Fresh"};
     title += sortNames[g_cfg.sortMode];
-    if ((int)title.size() < COLS) title += std::string(COLS - title.size(), ' ');
-    mvprintw(0, 0, "%s", title.substr(0, COLS).c_str());
-    attroff(COLOR_PAIR(CP_HEADER) | A_BOLD);
+    {
+        std::lock_guard<std::mutex> lk(g_costs.mtx);
+        if (g_costs.ready && g_costs.total.known)
+            title += "   Update: " + humanBytes(g_costs.total.bytes) + "/" +
+                     std::to_string(g_costs.total.files) + " files";
+    }
+    title += g_renderStats;
+    if (!paneNeedsDraw(g_paneHeader, baseKey() + title)) return;
+
+    WINDOW* w = g_paneHeader.win;
+    const int cols = g_layout.header.w;
+    if ((int)title.size() < cols) title += std::string(cols - title.size(), ' ');
+    wattron(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
+    mvwaddstr(w, 0, 0, fitColumns(title, cols).c_str());
+    wattroff(w, COLOR_PAIR(CP_HEADER) | A_BOLD);
 }
 
 static void drawSeparators() {
+    const Layout& L = g_layout;
+    if (g_frameGen == L.generation && g_frameTheme == g_cfg.themeIndex) return;
+    g_frameGen   = L.generation;
+    g_frameTheme = g_cfg.themeIndex;
+    erase();
     attron(COLOR_PAIR(CP_SEP));
-    mvhline(1,       0, ACS_HLINE, COLS);
-    mvhline(LINES-4, 0, ACS_HLINE, COLS);
-    for (int y = 1; y < LINES - 4; y++)
-        mvaddch(y, listPaneW(), ACS_VLINE);
-    mvaddch(1,       listPaneW(), ACS_TTEE);
-    mvaddch(LINES-4, listPaneW(), ACS_BTEE);
+    mvhline(L.sepTop,    0, ACS_HLINE, L.cols);
+    mvhline(L.sepBottom, 0, ACS_HLINE, L.cols);
+    mvvline(L.sepTop + 1, L.splitCol, ACS_VLINE, L.sepBottom - L.sepTop - 1);
+    mvaddch(L.sepTop,    L.splitCol, ACS_TTEE);
+    mvaddch(L.sepBottom, L.splitCol, ACS_BTEE);
     attroff(COLOR_PAIR(CP_SEP));
 }
 
+/* ─── per-row render cache ──────────────────────────────────────────────────
+ *
+ *  Row text (icon + display, truncated on a column boundary and padded to
+ *  exactly rowTextW columns) and its upgrade-count cell are built once per
+ *  (entry, layout, theme) and reused every frame until the repo list, the
+ *  layout, the theme or the upgrade counts change.
+ * ─────────────────────────────────────────────────────────────────────────── */
+
+struct RowRender {
+    uint64_t    reposGen    = 0;
+    uint64_t    layoutGen   = 0;
+    uint64_t    upgradesGen = 0;
+    uint64_t    searchGen   = 0;
+    uint64_t    deltaGen    = 0;   // g_deltas.gen, or ~0 while the column shows upgrades
+    uint64_t    freshGen    = 0;
+    Freshness   fresh       = Freshness::Unknown;   // badge after the status icon
+    uint64_t    remoteGen   = 0;
+    bool        remoteNewer = false;                // upstream InRelease is newer
+    int         theme       = -1;
+    std::string text;
+    std::string count;       // countColW columns: "  +12 " or blanks
+    bool        security = false;   // count is for a security pocket
+};
+static std::vector<RowRender> g_rowCache; // parallel to g_repos
+
+// Count in at most four columns: 999, 1.2k, 12k, 999k, 1.2M
+static std::string compactCount(int n) {
+    char b[16];
+    if      (n < 1000)    snprintf(b, sizeof(b), "%d", n);
+    else if (n < 10000)   snprintf(b, sizeof(b), "%d.%dk", n / 1000, n / 100 % 10);
+    else if (n < 1000000) snprintf(b, sizeof(b), "%dk", n / 1000);
+    else                  snprintf(b, sizeof(b), "%d.%dM", n / 1000000, n / 100000 % 10);
+    return b;
+}
+
+static const RowRender& rowRender(int rIdx) {
+    if (g_rowCache.size() != g_repos.size()) g_rowCache.resize(g_repos.size());
+    RowRender& rr = g_rowCache[(size_t)rIdx];
+    const int  w  = g_layout.rowTextW;
+    if (rr.reposGen == g_reposGen && rr.layoutGen == g_layout.generation &&
+        rr.upgradesGen == g_upgrades.gen && rr.searchGen == g_pkgSearch.gen &&
+        rr.deltaGen == (g_deltaColumn ? g_deltas.gen.load() : ~0ull) && rr.freshGen == g_fresh.gen &&
+        rr.remoteGen == g_remote.gen && rr.theme == g_cfg.themeIndex)
+        return rr;
+
+    const auto& r = g_repos[(size_t)rIdx];
+    const char* icon = r.enabled ? "\xe2\x97\x8f " : "\xe2\x97\x8b "; // ● / ○ UTF-8
+    std::string disp = icon + r.display;
+    int used = 0;
+    std::string text = fitColumns(disp, w, &used);
+    if (text.size() < disp.size()) {            // truncated: make room for "..."
+        text = fitColumns(disp, g_layout.rowTruncW, &used) + "...";
+        used += 3;
+    }
+    if (used < w) text.append((size_t)(w - used), ' ');
+
+    UpgradeCount uc;
+    char cell[32] = "";
+    if (!g_pkgSearch.query.empty()) {          // package search: hit counts instead
+        size_t hits = pkgSearchCountFor(r);
+        if (hits > 999) snprintf(cell, sizeof(cell), " 999+");
+        else if (hits)  snprintf(cell, sizeof(cell), " %4zu", hits);
+    } else if (g_deltaColumn) {                // new packages/new versions since last update
+        auto d = r.enabled ? indexDeltaFor(r) : nullptr;
+        if (d && d->known && d->newPackages + d->newVersions > 0) {
+            // " n/m" when it fits the visible cell, else the compact total
+            const size_t room = (size_t)std::max(0, g_layout.countColW - 2);
+            std::string v = std::to_string(d->newPackages) + "/" + std::to_string(d->newVersions);
+            if (v.size() > room) v = compactCount(d->newPackages + d->newVersions);
+            snprintf(cell, sizeof(cell), " %*s", (int)room, v.c_str());
+        }
+    } else if (r.enabled && upgradeCountFor(r, uc) && uc.upgrades > 0) {
+        if (uc.upgrades > 999) snprintf(cell, sizeof(cell), " +999");
+        else                   snprintf(cell, sizeof(cell), " %+4d", uc.upgrades);
+    }
+    rr.count = fitColumns(cell, g_layout.countColW);
+    rr.count.append((size_t)g_layout.countColW - rr.count.size(), ' ');
+    rr.security = uc.security;
+
+    rr.reposGen    = g_reposGen;
+    rr.layoutGen   = g_layout.generation;
+    rr.upgradesGen = g_upgrades.gen;
+    rr.searchGen   = g_pkgSearch.gen;
+    rr.deltaGen    = g_deltaColumn ? g_deltas.gen.load() : ~0ull;
+    FreshInfo fi;
+    rr.fresh       = freshnessFor(r, fi) ? fi.state : Freshness::Unknown;
+    rr.freshGen    = g_fresh.gen;
+    RemoteInfo ri;
+    rr.remoteNewer = remoteInfoFor(r, ri) && ri.state == RemoteState::Newer;
+    rr.remoteGen   = g_remote.gen;
+    rr.theme       = g_cfg.themeIndex;
+    rr.text        = std::move(text);
+    return rr;
+}
+
 static void drawList() {
-    int top = 2;
-    int lh  = listHeight();
-    int lpw = listPaneW();
-
-    for (int i = 0; i < lh; i++) {
+    const Layout& L = g_layout;
+    int lh  = L.list.h;
+    int lpw = L.list.w;
+
+    // Everything the rows are drawn from except the viewport
+    std::string content = baseKey() + std::to_string(g_reposGen) + "/" + std::to_string(g_filteredGen) +
+                          "/" + std::to_string(g_upgrades.gen.load()) + "/" + std::to_string(g_pkgSearch.gen.load()) +
+                          "/" + (g_deltaColumn ? std::to_string(g_deltas.gen.load()) : "u") +
+                          "/" + std::to_string(g_fresh.gen.load()) + "/" + std::to_string(g_remote.gen.load());
+    std::string key = content + "/" + std::to_string(g_scrollOff) + "/" + std::to_string(g_selected);
+    if (g_paneList.key == key) return;
+    WINDOW* w = g_paneList.win;
+
+    // Same rows, same geometry, new offset or selection: wscrl() the pane
+    // and repaint only the exposed rows and the two selection rows.  The
+    // native renderer gets the same shift as a terminal scroll hint.
+    static std::string lastContent;
+    static int         lastScrollOff = 0, lastSelected = 0;
+    int  delta       = g_scrollOff - lastScrollOff;
+    bool incremental = !g_paneList.key.empty() && lastContent == content && std::abs(delta) < lh;
+    if (incremental && delta != 0) g_native.hintScroll(L.list.y, lh, delta);
+    int prevSel = lastSelected - g_scrollOff;   // old selection row after the shift
+    lastContent   = content;
+    lastScrollOff = g_scrollOff;
+    lastSelected  = g_selected;
+    g_paneList.key = key;
+
+    auto paintRow = [&](int i) {
         int fIdx = i + g_scrollOff;
-
-        // Write a full-width blank line into the shadow buffer (no terminal I/O)
-        move(top + i, 0);
-        for (int x = 0; x < lpw; x++) addch(' ');
-
-        if (fIdx >= (int)g_filtered.size()) continue;
+        if (fIdx >= (int)g_filtered.size()) return;
 
         int rIdx       = g_filtered[fIdx];
         const auto& r  = g_repos[rIdx];
@@ -956,61 +5885,126 @@ static void drawList() {
         attr_t attrs   = COLOR_PAIR(pair);
         if (sel) attrs |= A_REVERSE | A_BOLD;
 
-        attron(attrs);
-        const char* icon = r.enabled ? "\xe2\x97\x8f " : "\xe2\x97\x8b "; // ● / ○ UTF-8
-        std::string disp = icon + r.display;
-        if ((int)disp.size() > lpw - 2)
-            disp = disp.substr(0, lpw - 5) + "...";
-        while ((int)disp.size() < lpw - 1) disp += ' ';
-        mvprintw(top + i, 1, "%s", disp.substr(0, lpw - 1).c_str());
-        attroff(attrs);
+        const RowRender& rr = rowRender(rIdx);
+        wattron(w, attrs);
+        mvwaddstr(w, i, 1, rr.text.c_str());
+        wattroff(w, attrs);
+        // Freshness badge in the gap after the status icon
+        if (rr.fresh == Freshness::Expired || rr.fresh == Freshness::Expiring || rr.fresh == Freshness::Stale) {
+            attr_t ba = rr.fresh == Freshness::Expired  ? (COLOR_PAIR(CP_STATUS_ERR) | A_BOLD)
+                      : rr.fresh == Freshness::Expiring ? COLOR_PAIR(CP_STATUS_ERR)
+                                                        : COLOR_PAIR(CP_DETAIL);
+            if (sel) ba |= A_REVERSE;
+            wattron(w, ba);
+            mvwaddstr(w, i, 2, rr.fresh == Freshness::Expired ? "X" : rr.fresh == Freshness::Expiring ? "!" : "~");
+            wattroff(w, ba);
+        } else if (rr.remoteNewer) {            // newer InRelease upstream
+            attr_t ba = COLOR_PAIR(CP_STATUS_OK) | A_BOLD;
+            if (sel) ba |= A_REVERSE;
+            wattron(w, ba);
+            mvwaddstr(w, i, 2, "\xe2\x86\x93");   // ↓
+            wattroff(w, ba);
+        }
+        // Upgrade column; security pockets stand out
+        if (L.countColW > 0) {
+            attr_t ca = rr.security ? (COLOR_PAIR(CP_STATUS_ERR) | A_BOLD) : COLOR_PAIR(CP_STATUS_OK);
+            if (sel) ca |= A_REVERSE;
+            wattron(w, ca);
+            mvwaddstr(w, i, L.countColX, rr.count.c_str());
+            wattroff(w, ca);
+        }
+    };
+
+    if (incremental) {
+        if (delta != 0) {
+            scrollok(w, TRUE);     // only around wscrl: a write to the last
+            wscrl(w, delta);       // cell must never scroll the pane
+            scrollok(w, FALSE);
+        }
+        std::vector<int> rows;
+        if (delta > 0) for (int i = lh - delta; i < lh; i++) rows.push_back(i);
+        else           for (int i = 0; i < -delta; i++)      rows.push_back(i);
+        rows.push_back(prevSel);
+        rows.push_back(g_selected - g_scrollOff);
+        for (int i : rows) {
+            if (i < 0 || i >= lh) continue;
+            wmove(w, i, 0);
+            wclrtoeol(w);
+            paintRow(i);
+        }
+    } else {
+        werase(w);
+        for (int i = 0; i < lh; i++) paintRow(i);
     }
 
     // Scrollbar
     if ((int)g_filtered.size() > lh) {
-        attron(COLOR_PAIR(CP_SEP) | A_DIM);
+        wattron(w, COLOR_PAIR(CP_SEP) | A_DIM);
         int barH   = std::max(1, lh * lh / (int)g_filtered.size());
         int barTop = lh * g_scrollOff / (int)g_filtered.size();
         for (int y = 0; y < lh; y++)
-            mvaddch(top + y, lpw - 1,
-                    (y >= barTop && y < barTop + barH) ? ACS_BLOCK : ACS_VLINE);
-        attroff(COLOR_PAIR(CP_SEP) | A_DIM);
+            mvwaddch(w, y, lpw - 1,
+                     (y >= barTop && y < barTop + barH) ? ACS_BLOCK : ACS_VLINE);
+        wattroff(w, COLOR_PAIR(CP_SEP) | A_DIM);
+    }
+}
+
+// Pick up a finished async result and decide what the detail pane shows
+static void syncDetailMeta(const RepoEntry& r) {
+    // Collect async meta result — only lock briefly to copy the struct
+    if (g_asyncMeta.ready.load()) {
+        std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
+        g_curMeta    = g_asyncMeta.meta;
+        g_curMetaKey = g_asyncMeta.resultKey;
+        g_metaEpoch++;
+        // Clear the flag so we don't keep locking on every frame
+        g_asyncMeta.ready.store(false);
+    }
+    // Never show metadata that belongs to a different entry; fall back to a
+    // cached result from an earlier ticket for this one.
+    const std::string key = metaKey(r);
+    g_metaShown = (g_curMetaKey == key);
+    if (!g_metaShown && cachedMeta(r, g_curMeta)) {
+        g_curMetaKey = key;
+        g_metaShown  = true;
+        g_metaEpoch++;
     }
 }
 
 static void drawDetailPane() {
-    int top = 2;
-    int lh  = listHeight();
-    int dx  = detailPaneX();
-    int dw  = detailPaneW();
+    const Layout& L = g_layout;
+    int lh  = L.detail.h;
+    int dw  = L.detail.w;
     if (dw < 5) return;
+    WINDOW* w = g_paneDetail.win;
+    const int valX = L.detailValX - L.detail.x;
 
-    // Blank the detail area in the shadow buffer — no terminal write yet
-    for (int y = top; y < top + lh; y++) {
-        move(y, dx);
-        for (int x = dx; x < COLS; x++) addch(' ');
-    }
-
-    if (g_filtered.empty()) {
-        attron(COLOR_PAIR(CP_DETAIL) | A_DIM);
-        mvprintw(top + lh/2, dx + 2, "No repositories found.");
-        attroff(COLOR_PAIR(CP_DETAIL) | A_DIM);
+    int rIdx = currentRepoIndex();
+    if (g_filtered.empty() || rIdx < 0) {
+        if (!paneNeedsDraw(g_paneDetail, baseKey() + "empty")) return;
+        wattron(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
+        mvwprintw(w, lh/2, 2, "No repositories found.");
+        wattroff(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
         return;
     }
-
-    int rIdx = currentRepoIndex();
-    if (rIdx < 0) return;
     const auto& r = g_repos[rIdx];
+    syncDetailMeta(r);
+    bool pending = metaPendingFor(r);
 
-    int y = top;
+    std::string key = baseKey() + std::to_string(g_reposGen) + "/" + std::to_string(rIdx) + "/" +
+                      (pending ? "p" : "-") + (g_metaShown ? "s" : "-") + "/" +
+                      std::to_string(g_metaEpoch) + "/" + std::to_string(g_uiEpoch.load());
+    if (!paneNeedsDraw(g_paneDetail, key)) return;
+
+    int y = 0;
     auto printField = [&](const char* label, const std::string& val) {
-        if (y >= top + lh) return;
-        attron(COLOR_PAIR(CP_DETAIL) | A_BOLD);
-        mvprintw(y, dx + 1, "%-12s", label);
-        attroff(COLOR_PAIR(CP_DETAIL) | A_BOLD);
-        attron(COLOR_PAIR(CP_DETAIL_VAL));
-        mvprintw(y, dx + 13, "%s", val.substr(0, (size_t)(dw - 14)).c_str());
-        attroff(COLOR_PAIR(CP_DETAIL_VAL));
+        if (y >= lh) return;
+        wattron(w, COLOR_PAIR(CP_DETAIL) | A_BOLD);
+        mvwprintw(w, y, 1, "%-12s", label);
+        wattroff(w, COLOR_PAIR(CP_DETAIL) | A_BOLD);
+        wattron(w, COLOR_PAIR(CP_DETAIL_VAL));
+        mvwaddstr(w, y, valX, fitColumns(val, L.detailValW).c_str());
+        wattroff(w, COLOR_PAIR(CP_DETAIL_VAL));
         y++;
     };
 
@@ -1025,40 +6019,59 @@ static void drawDetailPane() {
         char blk[16]; snprintf(blk, sizeof(blk), "%d", r.blockIndex);
         printField("Block:", blk);
     }
+    if (!r.archs.empty()) printField("Archs:", r.archs);
+    UpdateCost cost;
+    if (r.enabled && updateCostFor(r, cost)) printField("Upd cost:", describeCost(cost));
+    UpgradeCount uc;
+    if (r.enabled && upgradeCountFor(r, uc))
+        printField("Upgrades:", !uc.known ? "unknown (no local Packages lists)"
+                                : std::to_string(uc.upgrades) + " upgradable" +
+                                  (uc.security ? "  [SECURITY]" : ""));
+    std::string prio;
+    if (r.enabled && repoPriorityFor(r, prio)) printField("Priority:", prio);
+    FreshInfo fi;
+    if (freshnessFor(r, fi)) printField("Fresh:", describeFreshness(fi));
+    RemoteInfo ri;
+    if (remoteInfoFor(r, ri)) printField("Remote:", describeRemote(ri));
+    MirrorSuggestion ms;
+    MirrorScore sc;
+    if (mirrorSuggestionFor(r, ms))
+        printField("Mirror:", "try " + ms.to + " (" + humanRate(ms.toBps, ms.toCapped) + " vs " +
+                              humanRate(ms.fromBps) + ")");
+    else if (mirrorScoreFor(r.uri, sc))
+        printField("Mirror:", humanRate(sc.median, sc.capped) + " median of " + std::to_string(sc.samples) + " test" +
+                              (sc.samples == 1 ? "" : "s"));
+    if (r.enabled)
+        if (auto d = indexDeltaFor(r)) printField("Delta:", describeDelta(*d));
+    if (!g_pkgSearch.query.empty())
+        if (auto hits = pkgSearchHitsFor(r))
+            printField("Matches:", std::to_string(hits->size()) + " packages, best: " + hits->front().name);
     y++;
 
-    attron(COLOR_PAIR(CP_SEP));
-    if (y < top + lh) mvhline(y, dx, ACS_HLINE, dw);
+    wattron(w, COLOR_PAIR(CP_SEP));
+    if (y < lh) mvwhline(w, y, 0, ACS_HLINE, dw);
     y++;
-    attroff(COLOR_PAIR(CP_SEP));
-
-    // Collect async meta result — only lock briefly to copy the struct
-    if (g_asyncMeta.ready.load()) {
-        std::lock_guard<std::mutex> lk(g_asyncMeta.mtx);
-        g_curMeta   = g_asyncMeta.meta;
-        g_metaShown = true;
-        // Clear the flag so we don't keep locking on every frame
-        g_asyncMeta.ready.store(false);
-    }
+    wattroff(w, COLOR_PAIR(CP_SEP));
 
-    if (g_asyncMeta.running) {
-        if (y < top + lh) {
-            attron(COLOR_PAIR(CP_DETAIL) | A_DIM);
-            mvprintw(y++, dx + 1, "Fetching metadata...");
-            attroff(COLOR_PAIR(CP_DETAIL) | A_DIM);
+    if (pending) {
+        if (y < lh) {
+            wattron(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
+            mvwprintw(w, y++, 1, "Fetching metadata...");
+            wattroff(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
         }
     } else if (g_metaShown) {
         int pair = g_curMeta.reachable ? CP_STATUS_OK : CP_STATUS_ERR;
-        attron(COLOR_PAIR(pair));
-        if (y < top + lh)
-            mvprintw(y++, dx + 1, "Reachable:   %s",
-                     g_curMeta.reachable ? "Yes" : "No");
-        attroff(COLOR_PAIR(pair));
+        wattron(w, COLOR_PAIR(pair));
+        if (y < lh)
+            mvwprintw(w, y++, 1, "Reachable:   %s%s",
+                      g_curMeta.reachable ? "Yes" : "No",
+                      g_curMeta.latencyMs >= 0 ? (" (" + std::to_string(g_curMeta.latencyMs) + " ms)").c_str() : "");
+        wattroff(w, COLOR_PAIR(pair));
         if (!g_curMeta.error.empty()) {
-            if (y < top + lh) {
-                attron(COLOR_PAIR(CP_STATUS_ERR) | A_DIM);
-                mvprintw(y++, dx + 1, "%s", g_curMeta.error.substr(0, (size_t)(dw-2)).c_str());
-                attroff(COLOR_PAIR(CP_STATUS_ERR) | A_DIM);
+            if (y < lh) {
+                wattron(w, COLOR_PAIR(CP_STATUS_ERR) | A_DIM);
+                mvwaddstr(w, y++, 1, fitColumns(g_curMeta.error, dw - 2).c_str());
+                wattroff(w, COLOR_PAIR(CP_STATUS_ERR) | A_DIM);
             }
         } else {
             printField("Origin:",   g_curMeta.origin);
@@ -1066,143 +6079,290 @@ static void drawDetailPane() {
             printField("Suite:",    g_curMeta.suite);
             printField("Version:",  g_curMeta.version);
             printField("Date:",     g_curMeta.date);
+            if (!g_curMeta.validUntil.empty()) printField("Valid:", g_curMeta.validUntil);
             printField("Updated:",  g_curMeta.lastUpdate);
             if (!g_curMeta.description.empty())
                 printField("Desc:", g_curMeta.description);
         }
     } else {
-        if (y < top + lh) {
-            attron(COLOR_PAIR(CP_DETAIL) | A_DIM);
-            mvprintw(y++, dx + 1, "Press 'm' to fetch metadata");
-            attroff(COLOR_PAIR(CP_DETAIL) | A_DIM);
+        if (y < lh) {
+            wattron(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
+            mvwprintw(w, y++, 1, "Press 'm' to fetch metadata");
+            wattroff(w, COLOR_PAIR(CP_DETAIL) | A_DIM);
         }
     }
 }
 
 static void drawFooter() {
-    attron(COLOR_PAIR(CP_FOOTER));
-    std::string keys =
-        " F2:Toggle F3:Add F4:Del F5:Update F6:Reload "
-        "F7:Backup F8:Export m:Meta t:Theme s:Sort /:Search ^Z:Undo q:Quit";
-    if ((int)keys.size() < COLS) keys += std::string(COLS - keys.size(), ' ');
-    mvprintw(LINES - 1, 0, "%s", keys.substr(0, COLS).c_str());
-    attroff(COLOR_PAIR(CP_FOOTER));
+    static const std::string keys =
+        " F2:Toggle F3:Add F4:Del F5:Update u:UpdChg a:Arch n:Unused P:Policy f:Find d:PkgSearch D:Delta U:Remote b:Bench w:Rewrite "
+        "F6:Reload F7:Backup F8:Export m:Meta R:Probe t:Theme s:Sort /:Search ^Z:Undo q:Quit";
+    if (!paneNeedsDraw(g_paneFooter, baseKey())) return;
+    WINDOW* w = g_paneFooter.win;
+    const int cols = g_layout.footer.w;
+    std::string line = keys;
+    if ((int)line.size() < cols) line += std::string(cols - line.size(), ' ');
+    wattron(w, COLOR_PAIR(CP_FOOTER));
+    mvwaddstr(w, 0, 0, fitColumns(line, cols).c_str());
+    wattroff(w, COLOR_PAIR(CP_FOOTER));
 }
 
 static void drawStatus() {
-    move(LINES - 2, 0);
-    for (int x = 0; x < COLS; x++) addch(' '); // blank in shadow buffer only
+    const Rect& S = g_layout.status;
+    char cnt[32];
+    snprintf(cnt, sizeof(cnt), " [%d/%d] ",
+             (int)g_filtered.size(), (int)g_repos.size());
+    std::string prog;
+    if (g_loader.running) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " Loading %d/%d files ",
+                 g_loader.filesDone.load(), g_loader.filesTotal.load());
+        prog = buf;
+    } else if (g_pkgSearch.running) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " Searching %d/%d lists ",
+                 g_pkgSearch.listsDone.load(), g_pkgSearch.listsTotal.load());
+        prog = buf;
+    } else if (g_remote.running) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " Checking %d/%d ",
+                 g_remote.done.load(), g_remote.total.load());
+        prog = buf;
+    } else if (g_speed.running) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " Testing %d/%d mirrors ",
+                 g_speed.done.load(), g_speed.total.load());
+        prog = buf;
+    } else if (g_bulkProbe.running) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), " Probing %d/%d ",
+                 g_bulkProbe.done.load(), g_bulkProbe.total.load());
+        prog = buf;
+    }
+    std::string key = baseKey() + (g_searchMode ? "S" + g_filterStr
+                                                : std::string(g_statusErr ? "E" : "O") + cnt + g_status)
+                    + "\x1f" + prog;
+    if (!paneNeedsDraw(g_paneStatus, key)) return;
+    WINDOW* w = g_paneStatus.win;
 
     if (g_searchMode) {
-        attron(COLOR_PAIR(CP_SEARCH) | A_BOLD);
-        mvprintw(LINES - 2, 0, " Search: %s_", g_filterStr.c_str());
-        attroff(COLOR_PAIR(CP_SEARCH) | A_BOLD);
+        wattron(w, COLOR_PAIR(CP_SEARCH) | A_BOLD);
+        mvwaddstr(w, 0, 0, fitColumns(" Search: " + g_filterStr + "_", S.w).c_str());
+        wattroff(w, COLOR_PAIR(CP_SEARCH) | A_BOLD);
     } else {
         int pair = g_statusErr ? CP_STATUS_ERR : CP_STATUS_OK;
-        attron(COLOR_PAIR(pair));
-        char cnt[32];
-        snprintf(cnt, sizeof(cnt), " [%d/%d] ",
-                 (int)g_filtered.size(), (int)g_repos.size());
-        mvprintw(LINES - 2, 0, "%s%s", cnt,
-                 g_status.substr(0, COLS - 20).c_str());
-        attroff(COLOR_PAIR(pair));
+        wattron(w, COLOR_PAIR(pair));
+        mvwaddstr(w, 0, 0, (cnt + fitColumns(g_status, g_layout.statusMsgW)).c_str());
+        wattroff(w, COLOR_PAIR(pair));
+        int px = S.w - (int)prog.size();
+        if (!prog.empty() && px > 20) {
+            wattron(w, COLOR_PAIR(CP_SEARCH));
+            mvwaddstr(w, 0, px, prog.c_str());
+            wattroff(w, COLOR_PAIR(CP_SEARCH));
+        }
     }
 }
 
 static void redraw() {
     clampSelection();
-    // erase() marks the shadow buffer as blank — zero terminal writes here.
-    // This replaces clear() which flushed a blank frame to the terminal
-    // immediately, causing the visible flash on every redraw.
-    erase();
-    drawHeader();
+    // Each pane re-renders only if its key changed; nothing here touches
+    // the terminal.  The frame (stdscr) goes first so panes sit on top.
     drawSeparators();
+    drawHeader();
     drawList();
     drawDetailPane();
     drawStatus();
     drawFooter();
-    // wnoutrefresh(stdscr) copies our shadow buffer to ncurses' virtual screen.
-    // doupdate() then diffs the virtual screen against what the terminal
-    // actually shows and sends only the changed bytes — one atomic write,
-    // no blank frame, no flash.
+    // wnoutrefresh() copies each window's touched lines into ncurses'
+    // virtual screen; untouched panes cost nothing.  doupdate() (or the
+    // native renderer) then sends only the changed bytes in one write.
     wnoutrefresh(stdscr);
-    doupdate();
+    for (Pane* p : k_panes) wnoutrefresh(p->win);
+    // An open popup is layered on top of the main UI
+    static bool cursorOn = false;
+    bool wantCursor = g_dialog && g_dialog->wantsCursor();
+    if (g_dialog) g_dialog->draw();
+    if (wantCursor != cursorOn) { curs_set(wantCursor ? 1 : 0); cursorOn = wantCursor; }
+    presentFrame(wantCursor);
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 17 — POPUP DIALOGS
  * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Dialogs are state machines owned by g_dialog.  The event loop keeps
+//  running while one is open: redraw() paints the main UI first and the
+//  dialog window on top, so async results and progress keep updating
+//  underneath.  Keys go to handleKey(); when it reports completion the loop
+//  closes the dialog and runs its continuation, which may open the next one.
 
 static void popupCleanup(WINDOW* win) {
-    werase(win);
-    wnoutrefresh(win);  // mark popup area dirty in virtual screen — no immediate flush
+    int y = getbegy(win), x = getbegx(win), h = getmaxy(win), w = getmaxx(win);
     delwin(win);
-    touchwin(stdscr);   // tell ncurses stdscr needs full repaint
-    // doupdate() intentionally omitted — the next redraw() handles it cleanly
-}
-
-static bool confirmDialog(const std::string& msg) {
-    int w = std::min(74, COLS - 4), h = 6;
-    WINDOW* win = newwin(h, w, (LINES-h)/2, (COLS-w)/2);
-    wattron(win, COLOR_PAIR(CP_BORDER));
-    box(win, 0, 0);
-    wattroff(win, COLOR_PAIR(CP_BORDER));
-    wattron(win, A_BOLD);
-    mvwprintw(win, 1, 2, "Confirm Action");
-    wattroff(win, A_BOLD);
-    mvwprintw(win, 3, 2, "%s", msg.substr(0, w-4).c_str());
-    mvwprintw(win, 4, 2, "Press [y] to confirm, any other key to cancel.");
-    keypad(win, TRUE);
-    wnoutrefresh(win); doupdate();
-    int ch = wgetch(win);
-    popupCleanup(win);
-    return ch == 'y' || ch == 'Y';
-}
-
-static std::string inputDialog(const std::string& title, const std::string& prompt,
-                               const std::string& prefill = "") {
-    int w = std::min(76, COLS - 4), h = 8;
-    WINDOW* win = newwin(h, w, (LINES-h)/2, (COLS-w)/2);
-    wattron(win, COLOR_PAIR(CP_BORDER));
-    box(win, 0, 0);
-    wattroff(win, COLOR_PAIR(CP_BORDER));
-    wattron(win, A_BOLD); mvwprintw(win, 1, 2, "%s", title.c_str()); wattroff(win, A_BOLD);
-    mvwprintw(win, 2, 2, "%s", prompt.substr(0, w-4).c_str());
-    mvwprintw(win, 5, 2, "[Enter] confirm   [Esc] cancel");
-    keypad(win, TRUE);
-    echo(); curs_set(1);
-    char buf[512] = {};
-    if (!prefill.empty()) {
-        mvwprintw(win, 3, 2, "%s", prefill.substr(0, w-4).c_str());
-        strncpy(buf, prefill.c_str(), sizeof(buf)-1);
-    }
-    wattron(win, COLOR_PAIR(CP_SEARCH));
-    mvwgetnstr(win, 3, 2, buf, std::min((int)sizeof(buf)-1, w-4));
-    wattroff(win, COLOR_PAIR(CP_SEARCH));
-    curs_set(0); noecho();
-    popupCleanup(win);
-    return trimStr(std::string(buf));
+    // Only the rows the popup covered are re-copied from the windows beneath
+    // it; the next redraw() wnoutrefresh()es them — no full repaint.
+    invalidateRect(y, x, h, w);
 }
 
-/* Scrollable pager popup (for apt update output) */
-static void pagerDialog(const std::string& title, const std::vector<std::string>& lines) {
-    int w = std::min(COLS - 2, 100), h = LINES - 4;
-    WINDOW* win = newwin(h, w, (LINES-h)/2, (COLS-w)/2);
-    keypad(win, TRUE);
+// Base for popups: (re)creates a centred window of the requested size
+class PopupDialog : public Dialog {
+public:
+    ~PopupDialog() override { if (m_win) popupCleanup(m_win); }
+
+protected:
+    WINDOW* window(int h, int w) {
+        int y = std::max(0, (LINES - h) / 2), x = std::max(0, (COLS - w) / 2);
+        if (m_win && (m_h != h || m_w != w || m_y != y || m_x != x)) { popupCleanup(m_win); m_win = nullptr; }
+        if (!m_win) {
+            m_win = newwin(h, w, y, x);
+            m_h = h; m_w = w; m_y = y; m_x = x;
+        }
+        werase(m_win);      // also touches every line, so it wins over panes beneath
+        return m_win;
+    }
+
+    WINDOW* m_win = nullptr;
+    int     m_h = 0, m_w = 0, m_y = 0, m_x = 0;
+};
+
+// Yes/no prompt.  Optional detail lines (e.g. an impact report) are shown
+// in a scrollable area; arrows and PgUp/PgDn then scroll instead of cancelling.
+class ConfirmDialog : public PopupDialog {
+public:
+    ConfirmDialog(std::string msg, std::vector<std::string> details, std::function<void(bool)> done)
+        : m_msg(std::move(msg)), m_details(std::move(details)), m_done(std::move(done)) {}
+
+    void draw() override {
+        int listH = std::min((int)m_details.size(), std::max(0, LINES - 12));
+        int w = std::min(m_details.empty() ? 74 : 90, COLS - 4), h = 6 + (listH ? listH + 1 : 0);
+        WINDOW* win = window(h, w);
+        if (!win) return;
+        m_pageH = std::max(1, listH);
+        wattron(win, COLOR_PAIR(CP_BORDER));
+        box(win, 0, 0);
+        wattroff(win, COLOR_PAIR(CP_BORDER));
+        wattron(win, A_BOLD);
+        mvwprintw(win, 1, 2, "Confirm Action");
+        wattroff(win, A_BOLD);
+        mvwprintw(win, 3, 2, "%s", m_msg.substr(0, (size_t)std::max(0, w-4)).c_str());
+        for (int i = 0; i < listH; i++) {
+            int li = i + m_scroll;
+            if (li >= (int)m_details.size()) break;
+            wattron(win, COLOR_PAIR(CP_DETAIL_VAL));
+            mvwaddstr(win, 4 + i, 4, fitColumns(m_details[li], w - 6).c_str());
+            wattroff(win, COLOR_PAIR(CP_DETAIL_VAL));
+        }
+        if (listH && (int)m_details.size() > listH) {
+            wattron(win, A_DIM);
+            mvwprintw(win, 4 + listH, 4, "[%d-%d of %d]  arrows / PgUp / PgDn scroll",
+                      m_scroll + 1, std::min(m_scroll + listH, (int)m_details.size()),
+                      (int)m_details.size());
+            wattroff(win, A_DIM);
+        }
+        mvwprintw(win, h - 2, 2, "Press [y] to confirm, any other key to cancel.");
+        wnoutrefresh(win);
+    }
+
+    bool handleKey(int ch) override {
+        int maxScroll = std::max(0, (int)m_details.size() - m_pageH);
+        if (!m_details.empty()) {
+            switch (ch) {
+                case KEY_UP:    m_scroll = std::max(0, m_scroll - 1);                return false;
+                case KEY_DOWN:  m_scroll = std::min(maxScroll, m_scroll + 1);        return false;
+                case KEY_PPAGE: m_scroll = std::max(0, m_scroll - m_pageH);          return false;
+                case KEY_NPAGE: m_scroll = std::min(maxScroll, m_scroll + m_pageH);  return false;
+                default: break;
+            }
+        }
+        m_yes = (ch == 'y' || ch == 'Y');
+        return true;
+    }
+    void finish() override { if (m_done) m_done(m_yes); }
+
+private:
+    std::string               m_msg;
+    std::vector<std::string>  m_details;
+    std::function<void(bool)> m_done;
+    bool                      m_yes   = false;
+    int                       m_scroll = 0;
+    int                       m_pageH  = 1;
+};
+
+// Single-line editor; the continuation receives the trimmed text, or an
+// empty string if the dialog was cancelled.
+class InputDialog : public PopupDialog {
+public:
+    InputDialog(std::string title, std::string prompt, std::string prefill,
+                std::function<void(const std::string&)> done)
+        : m_title(std::move(title)), m_prompt(std::move(prompt)),
+          m_buf(std::move(prefill)), m_done(std::move(done)) {}
+
+    bool wantsCursor() const override { return true; }
+
+    void draw() override {
+        int w = std::min(76, COLS - 4), h = 8;
+        WINDOW* win = window(h, w);
+        if (!win) return;
+        int fieldW = std::max(1, w - 4);
+        wattron(win, COLOR_PAIR(CP_BORDER));
+        box(win, 0, 0);
+        wattroff(win, COLOR_PAIR(CP_BORDER));
+        wattron(win, A_BOLD); mvwprintw(win, 1, 2, "%s", m_title.c_str()); wattroff(win, A_BOLD);
+        mvwprintw(win, 2, 2, "%s", m_prompt.substr(0, (size_t)fieldW).c_str());
+        mvwprintw(win, 5, 2, "[Enter] confirm   [Esc] cancel");
+        // Show the tail of the buffer when it is wider than the field
+        std::string shown = (int)m_buf.size() >= fieldW
+            ? m_buf.substr(m_buf.size() - (size_t)(fieldW - 1)) : m_buf;
+        wattron(win, COLOR_PAIR(CP_SEARCH));
+        mvwprintw(win, 3, 2, "%-*s", fieldW, shown.c_str());
+        wattroff(win, COLOR_PAIR(CP_SEARCH));
+        wmove(win, 3, 2 + (int)shown.size());
+        wnoutrefresh(win);
+    }
+
+    bool handleKey(int ch) override {
+        if (ch == 27)                              { m_buf.clear(); return true; }
+        if (ch == '\n' || ch == '\r' || ch == KEY_ENTER) return true;
+        if (ch == KEY_BACKSPACE || ch == 127 || ch == '\b') {
+            if (!m_buf.empty()) m_buf.pop_back();
+        } else if (ch == ('u' & 0x1f)) {
+            m_buf.clear();
+        } else if (ch >= 32 && ch < 256 && ch != 127 && m_buf.size() < k_maxLen) {
+            m_buf += static_cast<char>(ch);
+        }
+        return false;
+    }
+
+    void finish() override { if (m_done) m_done(trimStr(m_buf)); }
+
+private:
+    static constexpr size_t k_maxLen = 511;
+    std::string                             m_title, m_prompt, m_buf;
+    std::function<void(const std::string&)> m_done;
+};
 
-    int scroll = 0;
-    int contentH = h - 4;
+/* Scrollable pager popup (for apt update output) */
+class PagerDialog : public PopupDialog {
+public:
+    PagerDialog(std::string title, std::vector<std::string> lines, std::function<void()> done)
+        : m_title(std::move(title)), m_lines(std::move(lines)), m_done(std::move(done)) {}
+
+    void draw() override {
+        int w = std::min(COLS - 2, 100), h = LINES - 4;
+        if (w < 10 || h < 5) return;
+        WINDOW* win = window(h, w);
+        if (!win) return;
+        int contentH = h - 4;
+        m_pageH = contentH;
 
-    while (true) {
-        werase(win);
         wattron(win, COLOR_PAIR(CP_BORDER)); box(win, 0, 0); wattroff(win, COLOR_PAIR(CP_BORDER));
-        wattron(win, A_BOLD); mvwprintw(win, 0, 2, " %s ", title.c_str()); wattroff(win, A_BOLD);
+        wattron(win, A_BOLD); mvwprintw(win, 0, 2, " %s ", fitColumns(m_title, w - 6).c_str()); wattroff(win, A_BOLD);
         mvwprintw(win, h-1, 2, " [↑/↓/PgUp/PgDn] Scroll   [q/Esc] Close ");
 
         for (int i = 0; i < contentH; i++) {
-            int li = i + scroll;
-            if (li >= (int)lines.size()) break;
-            const auto& l = lines[li];
+            int li = i + m_scroll;
+            if (li >= (int)m_lines.size()) break;
+            const auto& l = m_lines[li];
             // Color code apt output
             int pair = CP_DETAIL_VAL;
             if (l.rfind("Err:", 0) == 0 || l.rfind("E:", 0) == 0) pair = CP_PAGER_ERR;
@@ -1214,42 +6374,76 @@ static void pagerDialog(const std::string& title, const std::vector<std::string>
             wattroff(win, COLOR_PAIR(pair));
         }
         // Scroll bar
-        if ((int)lines.size() > contentH) {
-            int barH   = std::max(1, contentH * contentH / (int)lines.size());
-            int barTop = contentH * scroll / (int)lines.size();
+        if ((int)m_lines.size() > contentH) {
+            int barH   = std::max(1, contentH * contentH / (int)m_lines.size());
+            int barTop = contentH * m_scroll / (int)m_lines.size();
             for (int y = 0; y < contentH; y++)
                 mvwaddch(win, y + 2, w - 1,
                          (y >= barTop && y < barTop + barH) ? ACS_BLOCK : ACS_VLINE);
         }
-        wnoutrefresh(win); doupdate();
+        wnoutrefresh(win);
+    }
 
-        int ch = wgetch(win);
-        if (ch == 'q' || ch == 27 || ch == KEY_F(10)) break;
-        else if (ch == KEY_UP)    scroll = std::max(0, scroll - 1);
-        else if (ch == KEY_DOWN)  scroll = std::min((int)lines.size() - 1, scroll + 1);
-        else if (ch == KEY_NPAGE) scroll = std::min((int)lines.size() - 1, scroll + contentH);
-        else if (ch == KEY_PPAGE) scroll = std::max(0, scroll - contentH);
-        else if (ch == KEY_HOME)  scroll = 0;
-        else if (ch == KEY_END)   scroll = std::max(0, (int)lines.size() - contentH);
+    bool handleKey(int ch) override {
+        int n = (int)m_lines.size();
+        if (ch == 'q' || ch == 27 || ch == KEY_F(10)) return true;
+        else if (ch == KEY_UP)    m_scroll = std::max(0, m_scroll - 1);
+        else if (ch == KEY_DOWN)  m_scroll = std::max(0, std::min(n - 1, m_scroll + 1));
+        else if (ch == KEY_NPAGE) m_scroll = std::max(0, std::min(n - 1, m_scroll + m_pageH));
+        else if (ch == KEY_PPAGE) m_scroll = std::max(0, m_scroll - m_pageH);
+        else if (ch == KEY_HOME)  m_scroll = 0;
+        else if (ch == KEY_END)   m_scroll = std::max(0, n - m_pageH);
+        return false;
     }
-    popupCleanup(win);
+
+    void finish() override { if (m_done) m_done(); }
+
+private:
+    std::string              m_title;
+    std::vector<std::string> m_lines;
+    std::function<void()>    m_done;
+    int                      m_scroll = 0;
+    int                      m_pageH  = 1;
+};
+
+static void confirmDialog(const std::string& msg, std::function<void(bool)> done,
+                          std::vector<std::string> details = {}) {
+    g_dialog = std::make_unique<ConfirmDialog>(msg, std::move(details), std::move(done));
+}
+
+static void inputDialog(const std::string& title, const std::string& prompt,
+                        std::function<void(const std::string&)> done,
+                        const std::string& prefill = "") {
+    g_dialog = std::make_unique<InputDialog>(title, prompt, prefill, std::move(done));
+}
+
+static void pagerDialog(const std::string& title, std::vector<std::string> lines,
+                        std::function<void()> done = nullptr) {
+    g_dialog = std::make_unique<PagerDialog>(title, std::move(lines), std::move(done));
+}
+
+// Feed one key to the open dialog; closes it and runs its continuation when done
+static void dispatchDialogKey(int ch) {
+    if (!g_dialog || !g_dialog->handleKey(ch)) return;
+    std::unique_ptr<Dialog> d = std::move(g_dialog);
+    d->finish();   // may open the next dialog in a flow
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 18 — APT UPDATE (captures output)
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-static void runAptUpdate() {
-    if (!confirmDialog("Run 'sudo apt update' and show output?")) return;
-
+// Suspend curses, run `cmd` with its output teed to a log, then page the log
+static int runAptCommand(const std::string& cmd, const std::string& what) {
     def_prog_mode(); endwin();
 
-    // Run apt update, capture output to a temp file
+    // Run the command, capture output to a temp file
     std::string tmpFile = "/tmp/relix_update.log";
-    int ret = std::system(("sudo apt update 2>&1 | tee " + tmpFile).c_str());
+    int ret = std::system((cmd + " 2>&1 | tee " + tmpFile).c_str());
     printf("\nPress Enter to view output in pager...");
     fflush(stdout); getchar();
     reset_prog_mode(); refresh();
+    invalidateScreen();
 
     // Read captured output
     std::ifstream f(tmpFile);
@@ -1259,23 +6453,560 @@ static void runAptUpdate() {
     std::remove(tmpFile.c_str());
 
     if (!output.empty()) {
-        std::string title = "apt update output  (exit code: " + std::to_string(ret) + ")";
-        pagerDialog(title, output);
+        std::string title = what + " output  (exit code: " + std::to_string(ret) + ")";
+        pagerDialog(title, std::move(output));
+    }
+    setStatus(ret == 0 ? what + " completed successfully." : what + " finished with errors.", ret != 0);
+    invalidateUpdateCosts();   // list files changed under us
+    invalidateUpgradeCounts();
+    invalidateIndexDeltas();
+    invalidateFreshness();
+    invalidateRemoteCheck();
+    return ret;
+}
+
+// metaKey()s of entries enabled or added since their indexes were last fetched
+static std::set<std::string> g_changedRepos;
+
+static void runAptUpdate() {
+    confirmDialog("Run 'sudo apt update' and show output?", [](bool yes) {
+        if (!yes) return;
+        if (runAptCommand("sudo apt update", "apt update") == 0) g_changedRepos.clear();
+    });
+}
+
+// The deb822 stanza `r` came from, narrowed to its own URI and suite and
+// with Enabled: dropped.  Continuation lines (inline Signed-By keys) are kept.
+static std::vector<std::string> deb822Stanza(const RepoEntry& r) {
+    auto allLines = readAllLines(r.file);
+    std::vector<std::string> out;
+    int block = -1; bool inB = false, skipCont = false;
+    for (const auto& l : allLines) {
+        bool blank = trimStr(l).empty();
+        if (!blank && !inB) { block++; inB = true; }
+        if ( blank) { inB = false; continue; }
+        if (block != r.blockIndex) continue;
+        if (skipCont && (l[0] == ' ' || l[0] == '\t')) continue;
+        skipCont = false;
+        std::string t = trimStr(l);
+        if      (t.rfind("URIs:",    0) == 0) { out.push_back("URIs: " + r.uri);     skipCont = true; }
+        else if (t.rfind("Suites:",  0) == 0) { out.push_back("Suites: " + r.suite); skipCont = true; }
+        else if (t.rfind("Enabled:", 0) == 0) skipCont = true;
+        else out.push_back(l);
+    }
+    return out;
+}
+
+// Fetch indexes for `targets` only.  APT is pointed at a throw-away
+// sources list (one-line entries) and parts dir (deb822 stanzas), and
+// List-Cleanup is off so every other repo's lists stay in place — the new
+// files simply join them in /var/lib/apt/lists.
+static void runTargetedUpdate(const std::vector<RepoEntry>& targets) {
+    char tmpl[] = "/tmp/relix-update-XXXXXX";
+    if (!mkdtemp(tmpl)) { setStatus("Cannot create temp dir for update.", true); return; }
+    const std::string dir = tmpl, listFile = dir + "/sources.list", parts = dir + "/parts";
+
+    std::vector<std::string> listLines, stanzas;
+    for (const auto& r : targets) {
+        if (!r.isDeb822) { listLines.push_back(trimStr(r.display)); continue; }
+        auto st = deb822Stanza(r);
+        if (st.empty()) continue;
+        if (!stanzas.empty()) stanzas.push_back("");
+        stanzas.insert(stanzas.end(), st.begin(), st.end());
+    }
+    std::string err;
+    bool ok = true;
+    if (!listLines.empty()) ok = atomicWriteLines(listFile, listLines, err);
+    if (ok && !stanzas.empty()) {
+        fs::create_directory(parts);
+        ok = atomicWriteLines(parts + "/relix.sources", stanzas, err);
+    }
+    if (ok) {
+        std::string cmd = "sudo apt-get update"
+            " -o Dir::Etc::sourcelist=" + (listLines.empty() ? std::string("-") : listFile) +
+            " -o Dir::Etc::sourceparts=" + (stanzas.empty() ? std::string("-") : parts) +
+            " -o APT::Get::List-Cleanup=0";
+        if (runAptCommand(cmd, "Targeted update") == 0)
+            for (const auto& r : targets) g_changedRepos.erase(metaKey(r));
+    } else {
+        setStatus("Cannot write temp sources: " + err, true);
+    }
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+}
+
+// 'u': update repos changed this session, or the selected one if none were
+static void startTargetedUpdate() {
+    std::vector<RepoEntry> targets;
+    for (const auto& r : g_repos)
+        if (r.enabled && g_changedRepos.count(metaKey(r))) targets.push_back(r);
+    if (targets.empty()) {
+        int ri = currentRepoIndex();
+        if (ri >= 0 && g_repos[ri].enabled) targets.push_back(g_repos[ri]);
     }
-    setStatus(ret == 0 ? "apt update completed successfully." : "apt update finished with errors.", ret != 0);
+    if (targets.empty()) { setStatus("Nothing to update (selected repo is disabled).", true); return; }
+
+    std::string msg = targets.size() == 1
+        ? "Update only: " + targets[0].uri + " " + targets[0].suite + " ?"
+        : "Update only the " + std::to_string(targets.size()) + " changed repositories?";
+    confirmDialog(msg, [targets](bool yes) {
+        if (yes) runTargetedUpdate(targets);
+    });
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- *  SECTION 19 — MOUSE SUPPORT
+ *  SECTION 18A — REPO ACTIONS (shared by keys, mouse and dialog flows)
  * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Dialog continuations run after the popup closes, possibly after a reload,
+//  so they receive a copy of the RepoEntry rather than an index.
+
+static void reloadKeepSelection() {
+    int prev = g_selected;
+    loadRepos();
+    g_selected = std::min(prev, std::max(0, (int)g_filtered.size()-1));
+}
+
+// Confirm an action that takes `repo` out of service, listing the installed
+// packages it would strand (answered from the prebuilt package index).
+// Unless `askAlways`, a harmless action runs without a prompt.
+static void confirmRemoval(const std::string& what, const RepoEntry& repo,
+                           std::function<void(bool)> done, bool askAlways = true) {
+    std::string msg = what + ": " + repo.display.substr(0, 50) + " ?";
+    RemovalImpact im = removalImpact(repo);
+    if (!askAlways && (!im.known || im.lines.empty())) { done(true); return; }
+    if (!im.known) {
+        confirmDialog(msg, std::move(done), {"(impact unknown: package index not built or no local lists)"});
+        return;
+    }
+    if (im.lines.empty()) { confirmDialog(msg, std::move(done)); return; }
+    std::vector<std::string> details;
+    details.push_back(std::to_string(im.orphaned) + " installed package(s) lose their only source, " +
+                      std::to_string(im.downgraded) + " keep only older versions:");
+    details.insert(details.end(), im.lines.begin(), im.lines.end());
+    confirmDialog(msg, std::move(done), std::move(details));
+}
+
+static void toggleRepo(const RepoEntry& repo, const std::string& okMsg) {
+    std::string err;
+    bool ok = repo.isDeb822 ? toggleDeb822(repo, err) : toggleList(repo, err);
+    if (ok && !repo.enabled) g_changedRepos.insert(metaKey(repo));   // now enabled
+    reloadKeepSelection();
+    setStatus(ok ? okMsg : "Toggle FAILED: " + err, !ok);
+}
+
+static void deleteRepo(const RepoEntry& repo) {
+    std::string err;
+    bool ok = deleteRepoClean(repo, err);
+    reloadKeepSelection();
+    setStatus(ok ? "Deleted." : "Delete FAILED: " + err, !ok);
+}
+
+static void addRepoLine(const std::string& newLine, const std::string& dest) {
+    pushUndo(dest);
+    std::string be;
+    backupFile(dest, be);
+    std::ofstream f(dest, std::ios::app);
+    if (!f.is_open()) { setStatus("Cannot open " + dest, true); return; }
+    f << newLine << "\n"; f.flush();
+    bool good = f.good();
+    f.close();
+    loadRepos();
+    std::vector<RepoEntry> added;
+    for (const auto& r : g_repos)
+        if (r.file == dest && r.display == newLine) { g_changedRepos.insert(metaKey(r)); added.push_back(r); }
+    g_selected = (int)g_filtered.size()-1;
+    if (!good) { setStatus("Write error!", true); return; }
+    setStatus("Repository added to " + dest + " — checking upstream...");
+    validateNewRepos(added, [dest](const std::string& suffix, bool ok) {
+        setStatus("Repository added to " + dest + suffix, !ok);
+    });
+}
+
+// F3 flow: deb line → target file → append
+static void startAddRepo() {
+    inputDialog("Add Repository",
+        "Enter new deb line (e.g.: deb http://ppa.../ubuntu focal main):",
+        [](const std::string& newLine) {
+            if (newLine.empty()) { setStatus("Add cancelled."); return; }
+            if (newLine.rfind("deb", 0) != 0) {
+                setStatus("Invalid — must start with 'deb'.", true); return;
+            }
+            inputDialog("Add Repository", "Target file (Enter = /etc/apt/sources.list):",
+                [newLine](const std::string& dest) {
+                    // Esc (or a cleared field) yields "": cancel, never a default
+                    std::string d = trimStr(dest);
+                    if (d.empty()) { setStatus("Add cancelled."); return; }
+                    addRepoLine(newLine, d);
+                },
+                "/etc/apt/sources.list");
+        });
+}
+
+// Architecture report → confirm → one batched write per file
+static void showArchAdvice(const std::vector<ArchAdvice>& advice) {
+    if (advice.empty()) { setStatus("No architecture pruning needed."); return; }
+
+    std::vector<std::string> report;
+    uint64_t bytes = 0;
+    std::set<std::string> files;
+    for (const auto& a : advice) {
+        std::string keep;
+        for (const auto& k : a.keep) keep += (keep.empty() ? "" : ",") + k;
+        report.push_back(a.entry.uri + " " + a.entry.suite + "  (" + a.entry.file + ")");
+        for (const auto& d : a.drop) report.push_back("    drop " + d);
+        report.push_back("    restrict to " + keep + "   " +
+                         (a.priced ? "saves " + humanBytes(a.savedBytes) + " / " +
+                                     std::to_string(a.savedFiles) + " indexes per full update"
+                                   : "savings unknown (no cached Release)"));
+        bytes += a.savedBytes;
+        files.insert(a.entry.file);
+    }
+    std::string title = "Architecture pruning: " + std::to_string(advice.size()) +
+                        " entries, " + humanBytes(bytes);
+    pagerDialog(title, std::move(report), [advice, files] {
+        if (g_readOnly) { setStatus("Read-only mode.", true); return; }
+        confirmDialog("Apply arch restrictions to " + std::to_string(files.size()) + " file(s)?",
+            [advice](bool yes) {
+                if (!yes) return;
+                int written = 0;
+                std::string err;
+                bool ok = applyArchAdvice(advice, written, err);
+                reloadKeepSelection();
+                setStatus(ok ? "Restricted architectures in " + std::to_string(written) + " file(s)." + (err.empty() ? "" : " " + err)
+                             : "Arch pruning FAILED: " + err, !ok || !err.empty());
+            });
+    });
+}
+
+// 'a' flow: analyse on a Bulk worker (dpkg, apt-config, InRelease reads),
+// then report on the main thread
+static bool g_archScanRunning = false;
+
+static void startArchPrune() {
+    if (g_archScanRunning) { setStatus("Architecture scan already running..."); return; }
+    g_archScanRunning = true;
+    setStatus("Checking architectures against dpkg and cached InRelease files...");
+    g_sched.submit(JobClass::Bulk, [repos = g_repos, running = clearOnUi(g_archScanRunning)](JobCtx& ctx) {
+        (void)running;
+        auto advice = adviseArchPruning(repos, ctx.cancel.get());
+        if (ctx.cancelled()) return;
+        postToUi([advice = std::move(advice)] { showArchAdvice(advice); });
+    });
+}
+
+// 'n' flow: scan installed packages in the background → report → batched disable
+static bool g_usageScanRunning = false;
+
+static void startUnusedScan() {
+    if (g_usageScanRunning) { setStatus("Usage scan already running..."); return; }
+    g_usageScanRunning = true;
+    setStatus("Scanning installed packages against repository indexes...");
+    g_sched.submit(JobClass::Bulk, [repos = g_repos, running = clearOnUi(g_usageScanRunning)](JobCtx& ctx) {
+        (void)running;
+        auto usage = analyseRepoUsage(repos, ctx.cancel.get());
+        if (ctx.cancelled()) return;
+        postToUi([usage = std::move(usage)] {
+            std::vector<std::string> report;
+            std::vector<RepoEntry>   unused;
+            int unknown = 0;
+            for (const auto& u : usage) {
+                const std::string name = u.entry.uri + " " + u.entry.suite;
+                if (!u.indexed) { unknown++; continue; }
+                if (u.installed == 0) {
+                    report.push_back("UNUSED  " + name + "  (" + u.entry.file + ")");
+                    unused.push_back(u.entry);
+                    continue;
+                }
+                for (const auto& c : u.comps)
+                    if (c.second == 0)
+                        report.push_back("        " + name + "  component '" + c.first +
+                                         "' has no installed packages");
+            }
+            if (unknown)
+                report.push_back(std::to_string(unknown) + " enabled entries have no local Packages "
+                                 "lists (run apt update) and were not judged.");
+            if (report.empty()) { setStatus("Every enabled repository provides installed packages."); return; }
+            std::string title = "Repository usage: " + std::to_string(unused.size()) + " unused";
+            pagerDialog(title, std::move(report), [unused] {
+                if (unused.empty()) return;
+                if (g_readOnly) { setStatus("Read-only mode.", true); return; }
+                confirmDialog("Disable the " + std::to_string(unused.size()) + " unused repositories?",
+                    [unused](bool yes) {
+                        if (!yes) return;
+                        int written = 0;
+                        std::vector<std::string> skipped;
+                        std::string err;
+                        bool ok = disableEntries(unused, written, skipped, err);
+                        reloadKeepSelection();
+                        if (!ok) { setStatus("Disable FAILED: " + err, true); return; }
+                        setStatus("Disabled unused repositories in " + std::to_string(written) + " file(s)." +
+                                  (skipped.empty() ? "" : " Skipped " + std::to_string(skipped.size()) +
+                                                          " shared deb822 stanza(s)."));
+                        if (!skipped.empty()) pagerDialog("Not disabled", skipped);
+                    });
+            });
+        });
+    });
+}
 
-static void handleMouse() {
-    MEVENT ev;
-    if (getmouse(&ev) != OK) return;
+// 'P' flow: the simulated `apt-cache policy` for every installed package
+static void startPolicyView() {
+    auto pm = currentPolicy();
+    if (!pm) { setStatus("Policy not ready — package indexes are still being read."); return; }
+
+    std::vector<std::string> report;
+    for (const auto& p : pm->pins) {
+        std::string what = p.packages.empty() ? "*" : "";
+        for (const auto& n : p.packages) what += (what.empty() ? "" : " ") + n.text();
+        std::string pin = p.kind == PinStanza::Origin  ? "origin " + p.value.text()
+                        : p.kind == PinStanza::Version ? "version " + p.value.text() : "release ";
+        for (size_t i = 0; i < p.release.size(); i++)
+            pin += (i ? "," : "") + std::string(1, p.release[i].first) + "=" + p.release[i].second.text();
+        report.push_back("Pin " + std::to_string(p.priority) + "  " + what + "  " + pin + "  (" + p.where + ")");
+    }
+    if (!report.empty()) report.push_back("");
+    report.push_back("  package                          installed -> candidate        prio  from");
+    for (const auto& r : pm->rows) {
+        std::string name = r.package;
+        if (name.size() < 32) name.resize(32, ' ');
+        std::string ver = r.installed == r.candidate ? r.installed : r.installed + " -> " + r.candidate;
+        if (ver.size() < 28) ver.resize(28, ' ');
+        std::string prio = std::to_string(r.priority);
+        if (prio.size() < 5) prio.insert(0, 5 - prio.size(), ' ');
+        report.push_back((r.pinned ? "* " : "  ") + name + " " + ver + prio + "  " + r.from);
+    }
+    pagerDialog("Policy: " + std::to_string(pm->pins.size()) + " pins, " +
+                std::to_string(pm->pinnedCount) + " pinned packages", std::move(report));
+}
+
+// 'f' flow: file path → Contents search in the background → grouped hits
+static bool g_findRunning = false;
+
+static void startFindFile() {
+    if (g_findRunning) { setStatus("File search already running..."); return; }
+    inputDialog("Find File", "Path or part of one (e.g. /usr/bin/foo):", [](const std::string& q) {
+        std::string query = trimStr(q);
+        if (query.empty() || query == "/") { setStatus("Find cancelled."); return; }
+        g_findRunning = true;
+        setStatus("Searching Contents indexes for '" + query + "' (first search of a list builds its index)...");
+        g_sched.submit(JobClass::Bulk, [repos = g_repos, query, running = clearOnUi(g_findRunning)](JobCtx& ctx) {
+            (void)running;
+            auto res = searchContents(repos, query, ctx);
+            if (ctx.cancelled()) return;
+            postToUi([res = std::move(res), query] {
+                if (res.lists == 0) {
+                    setStatus("No Contents lists in /var/lib/apt/lists — enable the Contents-deb "
+                              "index target (e.g. install apt-file) and run apt update.", true);
+                    return;
+                }
+                if (res.lines.empty()) {
+                    setStatus("No package ships '" + query + "' (" + std::to_string(res.lists) + " lists searched).");
+                    return;
+                }
+                pagerDialog("Find '" + query + "': " + std::to_string(res.matches) + " matches in " +
+                            std::to_string(res.lists) + " lists (" + std::to_string(res.cached) + " from cache)",
+                            res.lines);
+            });
+        });
+    });
+}
+
+// 'd' flow: package name/description search, streamed into the list view
+static void startPkgSearch() {
+    inputDialog("Package Search", "Text in package names or descriptions (empty = clear):",
+        [](const std::string& q) {
+            std::string query = trimStr(q);
+            if (query.size() < 2) {
+                clearPkgSearch();
+                setStatus(query.empty() ? "Package search cleared." : "Search text needs 2+ characters.",
+                          !query.empty());
+                return;
+            }
+            setStatus("Searching package names and descriptions for '" + query + "'...");
+            startPkgSearchJob(g_repos, query, [query](size_t packages, size_t repos) {
+                setStatus(packages == 0 ? "No package name or description matches '" + query + "'."
+                                        : std::to_string(packages) + " package hits for '" + query + "' in " +
+                                          std::to_string(repos) + " repositories — Enter: list, Esc: clear.");
+            });
+        }, g_pkgSearch.query);
+}
+
+// 'U' flow: conditional GET of every enabled entry's InRelease
+static void startRemoteCheck() {
+    if (g_remote.running) { setStatus("Remote check already running..."); return; }
+    setStatus("Checking upstream InRelease files (conditional GET, one connection per host)...");
+    startRemoteCheckJob(g_repos, [](int newer, int checked, int opened, int reused) {
+        std::string tail = " (" + std::to_string(checked) + " checked; " + std::to_string(opened) +
+                           " new connection" + (opened == 1 ? "" : "s") + ", " + std::to_string(reused) + " reused).";
+        if (checked == 0) { setStatus("No repository could be checked — see Remote: in the details.", true); return; }
+        setStatus(newer == 0 ? "All checked repositories match upstream" + tail
+                             : std::to_string(newer) + " repositor" + (newer == 1 ? "y has" : "ies have") +
+                               " a newer InRelease upstream — run apt update" + tail);
+    });
+}
+
+// 'w' flow: FROM -> TO rules → preview diff → confirm → one write per file.
+// The prompt is prefilled with the speed test's mirror suggestions.
+static void startUriRewrite() {
+    if (g_readOnly) { setStatus("Read-only mode.", true); return; }
+    std::string prefill;
+    std::set<std::string> seen;
+    for (const auto& r : g_repos) {
+        MirrorSuggestion ms;
+        if (r.enabled && mirrorSuggestionFor(r, ms) && seen.insert(normMirror(r.uri)).second)
+            prefill += (prefill.empty() ? "" : "; ") + normMirror(r.uri) + " -> " + ms.to;
+    }
+    inputDialog("Rewrite URIs", "FROM -> TO rules, ';' between rules (prefix match):", [](const std::string& text) {
+        if (trimStr(text).empty()) { setStatus("Rewrite cancelled."); return; }
+        std::vector<UriRule> rules;
+        std::string err;
+        if (!parseUriRules(text, rules, err)) { setStatus(err, true); return; }
+        std::set<std::string> files;
+        for (const auto& r : g_repos) files.insert(r.file);
+        auto plan = planUriRewrite(std::vector<std::string>(files.begin(), files.end()), rules);
+        if (plan.empty()) { setStatus("No URI matches the rules."); return; }
+        int uris = 0;
+        for (const auto& f : plan) uris += f.uris;
+        std::string what = std::to_string(uris) + " URI(s) in " + std::to_string(plan.size()) + " file(s)";
+        pagerDialog("URI rewrite preview: " + what, rewritePreview(plan), [plan, rules, what] {
+            confirmDialog("Rewrite " + what + "?", [plan, rules, what](bool yes) {
+                if (!yes) { setStatus("Rewrite cancelled."); return; }
+                int written = 0;
+                std::string werr;
+                bool ok = applyUriRewrite(plan, written, werr);
+                reloadKeepSelection();
+                // Moved entries have no indexes from their new mirror yet
+                for (const auto& r : g_repos) {
+                    if (!r.enabled) continue;
+                    for (const auto& rule : rules)
+                        if (r.uri.compare(0, rule.to.size(), rule.to) == 0 &&
+                            (r.uri.size() == rule.to.size() || r.uri[rule.to.size()] == '/'))
+                            g_changedRepos.insert(metaKey(r));
+                }
+                setStatus(ok ? "Rewrote " + what + " (" + std::to_string(written) + " written) — u: update moved entries." +
+                               (werr.empty() ? "" : " " + werr)
+                             : "Rewrite FAILED: " + werr, !ok || !werr.empty());
+            });
+        });
+    }, prefill);
+}
+
+// 'b' flow: confirm → parallel capped range fetches → ranked report
+static void startSpeedTest() {
+    if (g_speed.running) { setStatus("Speed test already running..."); return; }
+    auto cands = speedCandidates(g_repos);
+    if (cands.empty()) { setStatus("No enabled http:// sources to test.", true); return; }
+    confirmDialog("Speed-test " + std::to_string(cands.size()) + " mirror(s)?  Up to 1 MiB each, " +
+                  std::to_string(g_cfg.speedtestKbps) + " KB/s total.", [cands](bool yes) {
+        if (!yes) { setStatus("Speed test cancelled."); return; }
+        setStatus("Measuring mirror throughput...");
+        startSpeedTestJob(cands, [](const std::vector<SpeedResult>& results) {
+            std::vector<std::string> lines;
+            lines.push_back("  mirror                                          this run       median (tests)      first byte");
+            std::vector<const SpeedResult*> ranked;
+            for (const auto& r : results) ranked.push_back(&r);
+            std::stable_sort(ranked.begin(), ranked.end(), [](const SpeedResult* a, const SpeedResult* b) {
+                if (a->sample.capped && b->sample.capped) return false;       // tie: both at the cap
+                return a->sample.bytesPerSec > b->sample.bytesPerSec;
+            });
+            for (const auto* r : ranked) {
+                std::string name = r->cand.base, med;
+                std::string now = r->local ? "skipped" : humanRate(r->sample.bytesPerSec, r->sample.capped);
+                if (name.size() < 48) name.resize(48, ' ');
+                if (now.size() < 15)  now.resize(15, ' ');
+                MirrorScore sc;
+                if (mirrorScoreFor(r->cand.base, sc))
+                    med = humanRate(sc.median, sc.capped) + " (" + std::to_string(sc.samples) + ")";
+                if (med.size() < 20) med.resize(20, ' ');
+                lines.push_back("  " + name + now + med +
+                                (r->error.empty() ? std::to_string(r->sample.ttfbMs) + " ms" : r->error));
+            }
+            std::map<std::string, std::pair<MirrorSuggestion, int>> byUri;   // suggestion, entries
+            for (const auto& e : g_repos) {
+                MirrorSuggestion ms;
+                if (e.enabled && mirrorSuggestionFor(e, ms)) {
+                    auto& slot = byUri[normMirror(e.uri)];
+                    slot.first = ms;
+                    slot.second++;
+                }
+            }
+            lines.push_back("");
+            if (byUri.empty()) {
+                lines.push_back(readMirrorGroups().empty()
+                    ? "No mirror groups in " + mirrorsPath() + " — list equivalent base URIs on one line to get suggestions."
+                    : "No suggestions: current mirrors are within 25% of the best, tied at the cap, or need 2+ tests.");
+            }
+            for (const auto& kv : byUri)
+                lines.push_back("Suggest: " + kv.first + "  ->  " + kv.second.first.to + "   (" +
+                                humanRate(kv.second.first.fromBps) + " -> " +
+                                humanRate(kv.second.first.toBps, kv.second.first.toCapped) +
+                                ", " + std::to_string(kv.second.second) + " entr" +
+                                (kv.second.second == 1 ? "y)" : "ies)"));
+            setStatus(std::to_string(results.size()) + " mirrors tested, " + std::to_string(byUri.size()) +
+                      " suggestion(s).");
+            pagerDialog("Mirror speed test (1 MiB of Packages.xz each, cap " +
+                        std::to_string(g_cfg.speedtestKbps) + " KB/s)", std::move(lines));
+        });
+    });
+}
+
+// Enter during a package search: ranked hits of the selected entry
+static void showPkgSearchHits(const RepoEntry& r) {
+    auto hits = pkgSearchHitsFor(r);
+    if (!hits) { setStatus("No matches in this repository."); return; }
+    std::vector<std::string> lines;
+    for (const auto& h : *hits) {
+        std::string name = h.name, ver = h.version;
+        if (name.size() < 28) name.resize(28, ' ');
+        if (ver.size() < 20)  ver.resize(20, ' ');
+        lines.push_back(name + " " + ver + " " + h.summary);
+    }
+    pagerDialog("'" + g_pkgSearch.query + "' in " + r.uri + " " + r.suite + ": " +
+                std::to_string(hits->size()) + " packages", std::move(lines));
+}
+
+// Enter: what the last apt update changed in the selected entry's lists
+static void showIndexDelta(const RepoEntry& r) {
+    auto d = r.enabled ? indexDeltaFor(r) : nullptr;
+    if (!d) { setStatus("No index snapshot for this repository (disabled or no local lists)."); return; }
+    if (!d->known) { setStatus("First snapshot of this repository's lists taken; changes show after the next update."); return; }
+    if (d->lines.empty()) { setStatus("No index changes since the previous update."); return; }
+    std::vector<std::string> lines{describeDelta(*d), ""};
+    lines.insert(lines.end(), d->lines.begin(), d->lines.end());
+    pagerDialog("Index delta: " + r.uri + " " + r.suite, std::move(lines));
+}
+
+// F8 flow: "export <path>" / "import <path>"
+static void startExportImport() {
+    inputDialog("Export / Import",
+        "Action: 'export /path/file.txt'  or  'import /path/file.txt'",
+        [](const std::string& action) {
+            if (action.empty()) return;
+            auto words = splitWords(action);
+            if (words.size() < 2) { setStatus("Usage: export <path> or import <path>", true); return; }
+            std::string err;
+            if (toLower(words[0]) == "export") {
+                bool ok = exportRepos(words[1], err);
+                setStatus(ok ? "Exported to " + words[1] : "Export FAILED: " + err, !ok);
+            } else if (toLower(words[0]) == "import") {
+                bool ok = importRepos(words[1], err);
+                if (ok) loadRepos();
+                setStatus(err.empty() ? "Imported." : err, !ok);
+            } else {
+                setStatus("Unknown action: " + words[0], true);
+            }
+        });
+}
 
-    int listTop = 2;
-    int lh      = listHeight();
-    int lpw     = listPaneW();
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 19 — MOUSE SUPPORT
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+static void handleMouse(const MEVENT& ev) {
+    int listTop = g_layout.list.y;
+    int lh      = g_layout.list.h;
+    int lpw     = g_layout.list.w;
 
     // Click in list pane
     if (ev.x < lpw && ev.y >= listTop && ev.y < listTop + lh) {
@@ -1283,22 +7014,16 @@ static void handleMouse() {
         if (clicked < (int)g_filtered.size()) {
             if (ev.bstate & BUTTON1_CLICKED) {
                 g_selected = clicked;
-                g_metaShown = false;
-                g_asyncMeta.ready = false;
             } else if (ev.bstate & BUTTON1_DOUBLE_CLICKED) {
                 // Double click = toggle
                 g_selected = clicked;
                 if (!g_readOnly && !g_filtered.empty()) {
                     int ri = currentRepoIndex();
                     if (ri >= 0) {
-                        std::string err;
-                        bool ok = g_repos[ri].isDeb822
-                            ? toggleDeb822(g_repos[ri], err)
-                            : toggleList  (g_repos[ri], err);
-                        int prev = g_selected;
-                        loadRepos();
-                        g_selected = std::min(prev, (int)g_filtered.size()-1);
-                        setStatus(ok ? "Toggled." : "Toggle FAILED: " + err, !ok);
+                        RepoEntry repo = g_repos[ri];
+                        auto done = [repo](bool yes) { if (yes) toggleRepo(repo, "Toggled."); };
+                        if (repo.enabled) confirmRemoval("Disable", repo, done, false);
+                        else              toggleRepo(repo, "Toggled.");
                     }
                 }
             }
@@ -1331,11 +7056,385 @@ static void handleSearchInput(int ch) {
     }
 }
 
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  SECTION 20A — INPUT BURSTS + SELECTION SETTLE
+ * ═══════════════════════════════════════════════════════════════════════════ */
+//
+//  Key repeat and wheel spins arrive as dozens of events per frame.  The
+//  event loop drains everything pending, applies it (selection moves are
+//  just integer updates) and renders once.  Metadata for the selection is
+//  only requested after it has stayed on one entry for k_settleMs.
+
+struct InputEvent {
+    int    ch;
+    MEVENT mouse; // valid when ch == KEY_MOUSE
+};
+
+static constexpr size_t k_maxBurst = 256;
+static constexpr int    k_settleMs = 200;
+
+// Collect `first` plus everything already queued, without blocking
+static std::vector<InputEvent> drainInput(int first) {
+    std::vector<InputEvent> burst;
+    int ch = first;
+    nodelay(stdscr, TRUE);
+    while (ch != ERR && burst.size() < k_maxBurst) {
+        InputEvent ev{ch, {}};
+        // getmouse() must be called per KEY_MOUSE or the event is lost
+        if (ch == KEY_MOUSE && getmouse(&ev.mouse) != OK) ev.ch = ERR;
+        if (ev.ch != ERR) burst.push_back(ev);
+        ch = getch();
+    }
+    nodelay(stdscr, FALSE);
+    timeout(100);
+    return burst;
+}
+
+static std::string               g_settleKey;   // metaKey() of the selection being timed
+static SteadyClock::time_point   g_settleSince;
+static bool                      g_settleDone = false;
+
+// Fetch the selected entry and prefetch its neighbours
+static void requestMetaForSelection() {
+    int ri = currentRepoIndex();
+    if (ri < 0) return;
+    RepoMeta cached;
+    if (!cachedMeta(g_repos[ri], cached)) fetchMetaAsync(g_repos[ri]);
+    std::vector<RepoEntry> near;
+    for (int d : {1, -1, 2, -2}) {
+        int f = g_selected + d;
+        if (f >= 0 && f < (int)g_filtered.size()) near.push_back(g_repos[g_filtered[f]]);
+    }
+    prefetchMeta(near);
+}
+
+// Called once per loop iteration; fires the debounced metadata request
+static void settleSelection() {
+    int ri = currentRepoIndex();
+    if (ri < 0) return;
+    std::string key = metaKey(g_repos[ri]);
+    auto now = SteadyClock::now();
+    if (key != g_settleKey) {
+        g_settleKey   = key;
+        g_settleSince = now;
+        g_settleDone  = false;
+        return;
+    }
+    if (g_settleDone || !g_cfg.autoMeta || g_dialog) return;
+    if (now - g_settleSince < std::chrono::milliseconds(k_settleMs)) return;
+    g_settleDone = true;
+    requestMetaForSelection();
+}
+
+static void runUiPosts() {
+    if (g_dialog) return;   // a posted step may open a dialog of its own
+    std::vector<std::function<void()>> posts;
+    {
+        std::lock_guard<std::mutex> lk(g_uiPostMtx);
+        posts.swap(g_uiPosts);
+    }
+    for (size_t i = 0; i < posts.size(); i++) {
+        posts[i]();
+        if (g_dialog && i + 1 < posts.size()) {   // keep the rest for later
+            std::lock_guard<std::mutex> lk(g_uiPostMtx);
+            g_uiPosts.insert(g_uiPosts.begin(), std::make_move_iterator(posts.begin() + (long)i + 1),
+                             std::make_move_iterator(posts.end()));
+            break;
+        }
+    }
+}
+
+// Identity of an entry that survives a reload (indices do not)
+static std::string reloadKey(const RepoEntry& r) {
+    return r.file + "\n" + std::to_string(r.blockIndex) + "\n" + r.types + "\n" + r.uri + "\n" + r.suite;
+}
+
+// Fold background-loaded batches into the view.  The selected entry stays
+// selected even when new rows sort in above it; after F6 the entry that was
+// selected before the reload is picked again once its batch arrives.
+static void mergeLoadedRepos() {
+    bool finished = false;
+    int  keep     = currentRepoIndex();
+    if (takeLoadedRepos(&finished)) {
+        rebuildFiltered();
+        if (!g_loader.keepKey.empty()) {
+            g_selected = std::min(g_loader.keepRow, std::max(0, (int)g_filtered.size() - 1));
+            for (size_t i = 0; i < g_filtered.size(); i++)
+                if (reloadKey(g_repos[(size_t)g_filtered[i]]) == g_loader.keepKey) {
+                    g_selected = (int)i;
+                    g_loader.keepKey.clear();
+                    break;
+                }
+        } else {
+            auto it = std::find(g_filtered.begin(), g_filtered.end(), keep);
+            if (it != g_filtered.end()) g_selected = (int)(it - g_filtered.begin());
+        }
+    }
+    if (finished) {
+        g_loader.keepKey.clear();
+        setStatus(g_loader.doneMsg + std::to_string(g_repos.size()) + " repositories loaded.");
+        g_loader.doneMsg.clear();
+    }
+}
+
+// rebuildFiltered() that stays on the selected entry when it is still shown
+static void refilterKeepSelection() {
+    int keep = currentRepoIndex();
+    rebuildFiltered();
+    auto it = std::find(g_filtered.begin(), g_filtered.end(), keep);
+    g_selected = it != g_filtered.end() ? (int)(it - g_filtered.begin())
+                                        : std::min(g_selected, std::max(0, (int)g_filtered.size() - 1));
+}
+
+// Re-filter the list as package-search results arrive
+static void refreshPkgSearchView() {
+    if (g_pkgSearch.shownGen == g_pkgSearch.gen) return;
+    g_pkgSearch.shownGen = g_pkgSearch.gen;
+    refilterKeepSelection();
+}
+
+// Re-sort when freshness states change under the "Fresh" sort mode
+static void refreshFreshnessView() {
+    static uint64_t shownGen = 0;
+    if (shownGen == g_fresh.gen) return;
+    shownGen = g_fresh.gen;
+    if (g_cfg.sortMode == 3) refilterKeepSelection();
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SECTION 21 — MAIN
  * ═══════════════════════════════════════════════════════════════════════════ */
 
+// Dispatch one key in normal mode; returns false when the user quits
+static bool handleKey(int ch) {
+    /* ── navigation ── */
+    switch (ch) {
+        // Selection moves are plain integer updates; the detail pane follows
+        // the selected entry's key and metadata is requested once it settles.
+        case KEY_UP:
+            if (g_selected > 0) g_selected--;
+            break;
+        case KEY_DOWN:
+            if (g_selected < (int)g_filtered.size()-1) g_selected++;
+            break;
+        case KEY_NPAGE:
+            g_selected = std::min(g_selected + listHeight(), (int)g_filtered.size()-1);
+            break;
+        case KEY_PPAGE:
+            g_selected = std::max(g_selected - listHeight(), 0);
+            break;
+        case KEY_HOME: g_selected = 0;                               break;
+        case KEY_END:  g_selected = (int)g_filtered.size()-1;        break;
+
+        /* ── F2: Toggle ── */
+        case KEY_F(2): {
+            if (g_readOnly) { setStatus("Read-only mode — run as root to edit.", true); break; }
+            if (g_filtered.empty()) break;
+            int ri = currentRepoIndex();
+            if (ri < 0) break;
+            RepoEntry repo = g_repos[ri];
+            auto done = [repo](bool yes) { if (yes) toggleRepo(repo, "Repository toggled."); };
+            if (repo.enabled)            confirmRemoval("Disable", repo, done, g_cfg.confirmToggle);
+            else if (g_cfg.confirmToggle) confirmDialog("Toggle: " + repo.display.substr(0, 50) + " ?", done);
+            else                          toggleRepo(repo, "Repository toggled.");
+            break;
+        }
+
+        /* ── F3: Add ── */
+        case KEY_F(3): {
+            if (g_readOnly) { setStatus("Read-only mode.", true); break; }
+            startAddRepo();
+            break;
+        }
+
+        /* ── F4: Delete ── */
+        case KEY_F(4): {
+            if (g_readOnly) { setStatus("Read-only mode.", true); break; }
+            if (g_filtered.empty()) break;
+            int ri = currentRepoIndex();
+            if (ri < 0) break;
+            RepoEntry repo = g_repos[ri];
+            auto done = [repo](bool yes) {
+                if (!yes) { setStatus("Delete cancelled."); return; }
+                deleteRepo(repo);
+            };
+            if (repo.enabled) confirmRemoval("Delete", repo, done);
+            else confirmDialog("Delete: " + repo.display.substr(0,55) + " ?", done);
+            break;
+        }
+
+        /* ── F5: apt update ── */
+        case KEY_F(5):
+            runAptUpdate();
+            break;
+
+        /* ── d: package name/description search ── */
+        case 'd':
+            startPkgSearch();
+            break;
+
+        /* ── Enter / Esc while a package search is shown ── */
+        case '\n':
+        case KEY_ENTER: {
+            int ri = currentRepoIndex();
+            if (ri < 0) break;
+            if (!g_pkgSearch.query.empty()) showPkgSearchHits(g_repos[ri]);
+            else showIndexDelta(g_repos[ri]);
+            break;
+        }
+        case 27:
+            if (!g_pkgSearch.query.empty()) { clearPkgSearch(); setStatus("Package search cleared."); }
+            break;
+
+        /* ── D: count column shows upgrades / index delta ── */
+        case 'D':
+            g_deltaColumn = !g_deltaColumn;
+            setStatus(g_deltaColumn ? "Count column: new packages/new versions since the previous apt update."
+                                    : "Count column: upgradable installed packages.");
+            break;
+
+        /* ── f: which package ships a file ── */
+        case 'f':
+            startFindFile();
+            break;
+
+        /* ── P: pinning / candidate policy ── */
+        case 'P':
+            startPolicyView();
+            break;
+
+        /* ── U: upstream InRelease newer than the local lists? ── */
+        case 'U':
+            startRemoteCheck();
+            break;
+
+        /* ── w: bulk URI rewrite ── */
+        case 'w':
+            startUriRewrite();
+            break;
+
+        /* ── b: mirror throughput test ── */
+        case 'b':
+            startSpeedTest();
+            break;
+
+        /* ── n: unused-repository detector ── */
+        case 'n':
+            startUnusedScan();
+            break;
+
+        /* ── a: architecture pruning advisor ── */
+        case 'a':
+            startArchPrune();
+            break;
+
+        /* ── u: apt update for changed / selected repos only ── */
+        case 'u':
+            startTargetedUpdate();
+            break;
+
+        /* ── F6: Reload ── */
+        case KEY_F(6): {
+            int ri = currentRepoIndex();
+            std::string keepKey = ri >= 0 ? reloadKey(g_repos[(size_t)ri]) : "";
+            int keepRow = g_selected;
+            loadReposAsync("Reloaded. ");
+            g_loader.keepKey = keepKey;
+            g_loader.keepRow = keepRow;
+            g_metaShown = false;
+            setStatus("Reloading repositories...");
+            break;
+        }
+
+        /* ── F7: Manual Backup ── */
+        case KEY_F(7): {
+            if (g_filtered.empty()) break;
+            int ri = currentRepoIndex();
+            if (ri < 0) break;
+            std::string err;
+            bool ok = backupFile(g_repos[ri].file, err);
+            setStatus(ok ? "Backed up: " + g_repos[ri].file : "Backup FAILED: " + err, !ok);
+            break;
+        }
+
+        /* ── F8: Export / Import ── */
+        case KEY_F(8): {
+            startExportImport();
+            break;
+        }
+
+        /* ── m: Fetch metadata async ── */
+        case 'm':
+        case 'M': {
+            if (g_filtered.empty()) break;
+            int ri = currentRepoIndex();
+            if (ri < 0) break;
+            g_curMetaKey.clear();   // force a fresh probe even if cached
+            dropCachedMeta(g_repos[ri]);
+            requestMetaForSelection();
+            setStatus("Fetching metadata (3 s timeout)...");
+            break;
+        }
+
+        /* ── R: Probe reachability of every repo ── */
+        case 'R': {
+            if (g_repos.empty()) break;
+            probeAllAsync(g_repos);
+            setStatus("Probing " + std::to_string(g_repos.size()) + " repositories in background...");
+            break;
+        }
+
+        /* ── t: Cycle theme ── */
+        case 't':
+        case 'T':
+            g_cfg.themeIndex = (g_cfg.themeIndex + 1) % k_themeCount;
+            applyTheme(g_cfg.themeIndex);
+            saveConfig();
+            setStatus(std::string("Theme: ") + k_themes[g_cfg.themeIndex].name);
+            break;
+
+        /* ── s: Cycle sort ── */
+        case 's':
+        case 'S':
+            g_cfg.sortMode = (g_cfg.sortMode + 1) % 4;
+            rebuildFiltered();
+            saveConfig();
+            { static const char* n[] = {"File","Status","Alphabetical","Freshness"};
+              setStatus(std::string("Sort: ") + n[g_cfg.sortMode]); }
+            break;
+
+        /* ── /: Enter search mode ── */
+        case '/':
+            g_searchMode = true;
+            g_filterStr.clear();
+            rebuildFiltered();
+            g_selected = 0;
+            break;
+
+        /* ── Ctrl+Z: Undo ── */
+        case ('z' & 0x1f): {
+            if (g_readOnly) { setStatus("Read-only mode.", true); break; }
+            std::string err;
+            bool ok = applyUndo(err);
+            int prev = g_selected;
+            loadRepos();
+            g_selected = std::min(prev, std::max(0, (int)g_filtered.size()-1));
+            setStatus(ok ? "Undo applied." : err, !ok);
+            break;
+        }
+
+        /* ── q / F10: Quit ── */
+        case 'q':
+        case 'Q':
+        case KEY_F(10):
+            return false;   // main() saves config and tears down once
+    }
+    return true;
+}
+
 int main() {
+    setlocale(LC_ALL, "");   // UTF-8 output and wcwidth() need the user's locale
+
     /* ── privilege check ── */
     g_isRoot   = (geteuid() == 0);
     g_readOnly = !g_isRoot;
@@ -1343,13 +7442,13 @@ int main() {
     /* ── load config + OS info + repos ── */
     loadConfig();
     g_os = detectOS();
-    loadRepos();
 
     /* ── ncurses init ── */
     initscr();
     cbreak();
     noecho();
     keypad(stdscr, TRUE);
+    set_escdelay(50);   // Esc closes popups without the 1 s keypad wait
     curs_set(0);
     start_color();
     use_default_colors();
@@ -1360,220 +7459,86 @@ int main() {
 
     // Apply saved theme
     applyTheme(g_cfg.themeIndex);
+    computeLayout();
 
     // Set timeout so we can poll async meta (100 ms)
     timeout(100);
 
-    if (g_readOnly)
+    // Background workers: one reserved for interactive jobs + shared pool
+    g_sched.start((int)std::min(4u, std::max(2u, std::thread::hardware_concurrency())));
+
+    // Repos stream in from a worker; the first frame is painted right away
+    if (g_readOnly) {
+        loadReposAsync("");
         setStatus("Running without root — read-only mode. Use 'sudo' to edit repos.", true);
-    else
-        setStatus("Ready. " + std::to_string(g_repos.size()) + " repositories loaded.");
+    } else {
+        loadReposAsync("Ready. ");
+        setStatus("Loading repositories...");
+    }
+
+    // Optional native renderer; ncurses doupdate() stays the fallback
+    const char* envRenderer = getenv("RELIX_RENDERER");
+    std::string renderer = envRenderer ? envRenderer : g_cfg.renderer;
+    if (renderer == "native") {
+        g_native.enable();
+        if (!g_native.active())
+            setStatus("Native renderer unavailable (needs ncursesw + UTF-8) — using ncurses.", true);
+    }
 
     /* ── event loop ── */
-    while (true) {
+    bool running = true;
+    while (running) {
+        // While a resize is still settling, skip frames built on stale geometry
+        if (g_resizePending && !applyPendingResize()) { napms(10); continue; }
+        mergeLoadedRepos();
+        runUiPosts();
+        refreshUpdateCosts(g_loader.running);
+        refreshUpgradeCounts(g_loader.running);
+        refreshPolicy();
+        refreshIndexDeltas(g_loader.running);
+        refreshFreshness(g_loader.running);
+        refreshMirrorAdvice(g_loader.running);
+        refreshFreshnessView();
+        refreshPkgSearchView();
+        settleSelection();
         // Single redraw per frame. drawDetailPane() internally checks
         // g_asyncMeta.ready and picks up new metadata without a second call.
         redraw();
         int ch = getch();
         if (ch == ERR) continue; // 100 ms timeout — loop and redraw
+        g_sched.noteInput();     // background jobs back off while keys arrive
+        // Renderer stats are refreshed per input burst, not per frame, so
+        // showing them never causes a frame of its own.
+        if (g_native.active()) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "   Out: %zu B/frame (avg %zu)",
+                     g_native.lastFrameBytes(), g_native.avgFrameBytes());
+            g_renderStats = buf;
+        }
 
-        /* ── search mode ── */
-        if (g_searchMode) { handleSearchInput(ch); continue; }
-
-        /* ── mouse ── */
-        if (ch == KEY_MOUSE) { handleMouse(); continue; }
-
-        /* ── navigation ── */
-        switch (ch) {
-            case KEY_UP:
-                if (g_selected > 0) { g_selected--; g_metaShown = false; g_asyncMeta.ready = false; }
-                break;
-            case KEY_DOWN:
-                if (g_selected < (int)g_filtered.size()-1) { g_selected++; g_metaShown = false; g_asyncMeta.ready = false; }
-                break;
-            case KEY_NPAGE:
-                g_selected = std::min(g_selected + listHeight(), (int)g_filtered.size()-1);
-                g_metaShown = false;
-                break;
-            case KEY_PPAGE:
-                g_selected = std::max(g_selected - listHeight(), 0);
-                g_metaShown = false;
-                break;
-            case KEY_HOME: g_selected = 0;                               g_metaShown = false; break;
-            case KEY_END:  g_selected = (int)g_filtered.size()-1;        g_metaShown = false; break;
-
-            /* ── F2: Toggle ── */
-            case KEY_F(2): {
-                if (g_readOnly) { setStatus("Read-only mode — run as root to edit.", true); break; }
-                if (g_filtered.empty()) break;
-                int ri = currentRepoIndex();
-                if (ri < 0) break;
-                if (g_cfg.confirmToggle &&
-                    !confirmDialog("Toggle: " + g_repos[ri].display.substr(0, 50) + " ?"))
-                    break;
-                std::string err;
-                bool ok = g_repos[ri].isDeb822
-                    ? toggleDeb822(g_repos[ri], err)
-                    : toggleList  (g_repos[ri], err);
-                int prev = g_selected;
-                loadRepos();
-                g_selected = std::min(prev, (int)g_filtered.size()-1);
-                setStatus(ok ? "Repository toggled." : "Toggle FAILED: " + err, !ok);
-                break;
-            }
-
-            /* ── F3: Add ── */
-            case KEY_F(3): {
-                if (g_readOnly) { setStatus("Read-only mode.", true); break; }
-                std::string newLine = inputDialog("Add Repository",
-                    "Enter new deb line (e.g.: deb http://ppa.../ubuntu focal main):");
-                if (newLine.empty()) { setStatus("Add cancelled."); break; }
-                if (newLine.rfind("deb", 0) != 0) {
-                    setStatus("Invalid — must start with 'deb'.", true); break;
-                }
-                std::string dest = inputDialog("Add Repository",
-                    "Target file (Enter = /etc/apt/sources.list):",
-                    "/etc/apt/sources.list");
-                if (dest.empty()) dest = "/etc/apt/sources.list";
-                pushUndo(dest);
-                std::string be;
-                backupFile(dest, be);
-                std::ofstream f(dest, std::ios::app);
-                if (!f.is_open()) { setStatus("Cannot open " + dest, true); break; }
-                f << newLine << "\n"; f.flush();
-                loadRepos();
-                g_selected = (int)g_filtered.size()-1;
-                setStatus(f.good() ? "Repository added to " + dest : "Write error!", !f.good());
-                break;
-            }
-
-            /* ── F4: Delete ── */
-            case KEY_F(4): {
-                if (g_readOnly) { setStatus("Read-only mode.", true); break; }
-                if (g_filtered.empty()) break;
-                int ri = currentRepoIndex();
-                if (ri < 0) break;
-                std::string prompt = "Delete: " + g_repos[ri].display.substr(0,55) + " ?";
-                if (!confirmDialog(prompt)) { setStatus("Delete cancelled."); break; }
-                std::string err;
-                bool ok = deleteRepoClean(g_repos[ri], err);
-                int prev = g_selected;
-                loadRepos();
-                g_selected = std::min(prev, std::max(0, (int)g_filtered.size()-1));
-                setStatus(ok ? "Deleted." : "Delete FAILED: " + err, !ok);
-                break;
-            }
-
-            /* ── F5: apt update ── */
-            case KEY_F(5):
-                runAptUpdate();
-                break;
-
-            /* ── F6: Reload ── */
-            case KEY_F(6): {
-                int prev = g_selected;
-                loadRepos();
-                g_selected = std::min(prev, std::max(0, (int)g_filtered.size()-1));
-                g_metaShown = false;
-                setStatus("Reloaded. " + std::to_string(g_repos.size()) + " repos.");
-                break;
-            }
-
-            /* ── F7: Manual Backup ── */
-            case KEY_F(7): {
-                if (g_filtered.empty()) break;
-                int ri = currentRepoIndex();
-                if (ri < 0) break;
-                std::string err;
-                bool ok = backupFile(g_repos[ri].file, err);
-                setStatus(ok ? "Backed up: " + g_repos[ri].file : "Backup FAILED: " + err, !ok);
-                break;
-            }
+        // Apply the whole pending burst, then render once
+        for (const auto& ev : drainInput(ch)) {
+            /* ── terminal resize: debounced relayout, never a dialog key ── */
+            if (ev.ch == KEY_RESIZE) { noteResize(); continue; }
 
-            /* ── F8: Export / Import ── */
-            case KEY_F(8): {
-                std::string action = inputDialog("Export / Import",
-                    "Action: 'export /path/file.txt'  or  'import /path/file.txt'");
-                if (action.empty()) break;
-                auto words = splitWords(action);
-                if (words.size() < 2) { setStatus("Usage: export <path> or import <path>", true); break; }
-                std::string err;
-                if (toLower(words[0]) == "export") {
-                    bool ok = exportRepos(words[1], err);
-                    setStatus(ok ? "Exported to " + words[1] : "Export FAILED: " + err, !ok);
-                } else if (toLower(words[0]) == "import") {
-                    bool ok = importRepos(words[1], err);
-                    if (ok) loadRepos();
-                    setStatus(err.empty() ? "Imported." : err, !ok);
-                } else {
-                    setStatus("Unknown action: " + words[0], true);
-                }
-                break;
+            /* ── open popup owns the keyboard; the loop keeps redrawing ── */
+            if (g_dialog) {
+                if (ev.ch != KEY_MOUSE) dispatchDialogKey(ev.ch);
+                continue;
             }
 
-            /* ── m: Fetch metadata async ── */
-            case 'm':
-            case 'M': {
-                if (g_filtered.empty()) break;
-                int ri = currentRepoIndex();
-                if (ri < 0) break;
-                g_metaShown = false;
-                g_asyncMeta.ready = false;
-                fetchMetaAsync(g_repos[ri]);
-                setStatus("Fetching metadata (3 s timeout)...");
-                break;
-            }
+            /* ── search mode ── */
+            if (g_searchMode) { handleSearchInput(ev.ch); continue; }
 
-            /* ── t: Cycle theme ── */
-            case 't':
-            case 'T':
-                g_cfg.themeIndex = (g_cfg.themeIndex + 1) % k_themeCount;
-                applyTheme(g_cfg.themeIndex);
-                saveConfig();
-                setStatus(std::string("Theme: ") + k_themes[g_cfg.themeIndex].name);
-                break;
-
-            /* ── s: Cycle sort ── */
-            case 's':
-            case 'S':
-                g_cfg.sortMode = (g_cfg.sortMode + 1) % 3;
-                rebuildFiltered();
-                saveConfig();
-                { static const char* n[] = {"File","Status","Alphabetical"};
-                  setStatus(std::string("Sort: ") + n[g_cfg.sortMode]); }
-                break;
-
-            /* ── /: Enter search mode ── */
-            case '/':
-                g_searchMode = true;
-                g_filterStr.clear();
-                rebuildFiltered();
-                g_selected = 0;
-                break;
-
-            /* ── Ctrl+Z: Undo ── */
-            case ('z' & 0x1f): {
-                if (g_readOnly) { setStatus("Read-only mode.", true); break; }
-                std::string err;
-                bool ok = applyUndo(err);
-                int prev = g_selected;
-                loadRepos();
-                g_selected = std::min(prev, std::max(0, (int)g_filtered.size()-1));
-                setStatus(ok ? "Undo applied." : err, !ok);
-                break;
-            }
+            /* ── mouse ── */
+            if (ev.ch == KEY_MOUSE) { handleMouse(ev.mouse); continue; }
 
-            /* ── q / F10: Quit ── */
-            case 'q':
-            case 'Q':
-            case KEY_F(10):
-                saveConfig();
-                endwin();
-                return 0;
+            if (!handleKey(ev.ch)) { running = false; break; }
         }
     }
 
     saveConfig();
+    g_sched.shutdown();
     endwin();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Run relix against the local fixture server (needs root: it adds a sources
+# file and cached lists, and removes them again on exit).
+#
+#   sudo tools/http-fixture/run.sh [path/to/relix] [serve.py options...]
+#
+# Then press U.  Expected Remote: lines (detail pane):
+#   127.0.0.1:8765/debian current   up to date (304 Not Modified)
+#   127.0.0.1:8765/debian newer     UPDATE AVAILABLE, ↓ badge on the row
+#   127.0.0.1:8765/old    current   redirect to /debian/ followed, up to date
+#   127.0.0.1:8765/tls    current   moved to https://... (not followed)
+#   127.0.0.1:8765/debian missing   check failed: HTTP 404
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+BIN=${1:-./build/relix}
+[ $# -gt 0 ] && shift
+PORT=8765
+LISTS=/var/lib/apt/lists
+SRC=/etc/apt/sources.list.d/zz-relix-fixture.list
+CACHE=$(mktemp -d)
+
+if [ "$(id -u)" -ne 0 ]; then echo "run as root" >&2; exit 1; fi
+if [ ! -x "$BIN" ]; then echo "no relix binary at $BIN" >&2; exit 1; fi
+
+# Fixed mtimes: Last-Modified and If-Modified-Since must line up
+touch -d '2026-01-01 00:00:00 UTC' "$HERE/root/debian/dists/current/InRelease"
+touch -d '2026-02-01 00:00:00 UTC' "$HERE/root/debian/dists/newer/InRelease"
+
+for p in debian old tls; do
+    cp -p "$HERE/root/debian/dists/current/InRelease" "$LISTS/127.0.0.1:${PORT}_${p}_dists_current_InRelease"
+done
+cp "$HERE/lists/newer_InRelease" "$LISTS/127.0.0.1:${PORT}_debian_dists_newer_InRelease"
+touch -d '2026-01-01 00:00:00 UTC' "$LISTS/127.0.0.1:${PORT}_debian_dists_newer_InRelease"
+
+cat > "$SRC" <<EOF
+deb http://127.0.0.1:$PORT/debian current main
+deb http://127.0.0.1:$PORT/debian newer main
+deb http://127.0.0.1:$PORT/old current main
+deb http://127.0.0.1:$PORT/tls current main
+deb http://127.0.0.1:$PORT/debian missing main
+EOF
+
+python3 "$HERE/serve.py" --port "$PORT" "$@" 2>"$CACHE/serve.log" &
+SERVER=$!
+
+cleanup() {
+    kill "$SERVER" 2>/dev/null || true
+    rm -f "$SRC" "$LISTS"/127.0.0.1:${PORT}_*
+    echo "server log:"; cat "$CACHE/serve.log"
+    rm -rf "$CACHE"
+}
+trap cleanup EXIT INT TERM
+
+sleep 0.5
+XDG_CACHE_HOME="$CACHE" "$BIN"
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Local HTTP server for exercising relix's HTTP client (U, F3, b).
+
+Serves files under --root with the behaviour an APT mirror shows:
+
+  * HTTP/1.1 keep-alive (or HTTP/1.0 with --http10)
+  * Last-Modified from the file mtime, ETag from its content
+  * 304 for If-None-Match / If-Modified-Since
+  * 206 for "Range: bytes=a-b"
+  * chunked bodies with --chunked, a rate limit with --slow KBPS
+  * redirects from <root>/redirects, one rule per line:
+        <path-prefix> <status> <target-prefix>
+    e.g. "/old/ 301 /debian/" or "/tls/ 301 https://example.org/debian/"
+  * any missing */Packages.xz is synthesised (2 MiB) for the speed test
+
+Every request is logged to stderr with its conditional headers, so
+connection reuse (client port) and revalidation can be checked.
+"""
+import argparse
+import email.utils
+import hashlib
+import http.server
+import os
+import sys
+import time
+
+ARGS = None
+BLOB = bytes((i * 131 + 7) & 0xFF for i in range(2 << 20))
+
+
+def redirect_for(path):
+    rules = os.path.join(ARGS.root, "redirects")
+    if not os.path.isfile(rules):
+        return None
+    with open(rules) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) == 3 and path.startswith(parts[0]):
+                return int(parts[1]), parts[2] + path[len(parts[0]):]
+    return None
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    def log_message(self, fmt, *args):
+        sys.stderr.write("port=%s %s %s IMS=%s INM=%s Range=%s\n" % (
+            self.client_address[1], self.command, self.path,
+            self.headers.get("If-Modified-Since"), self.headers.get("If-None-Match"),
+            self.headers.get("Range")))
+
+    def reply(self, code, headers=(), body=b""):
+        self.send_response(code)
+        for k, v in headers:
+            self.send_header(k, v)
+        if ARGS.chunked and body:
+            self.send_header("Transfer-Encoding", "chunked")
+            self.end_headers()
+            if self.command != "HEAD":
+                for i in range(0, len(body), 512):
+                    c = body[i:i + 512]
+                    self.wfile.write(b"%x\r\n" % len(c) + c + b"\r\n")
+                self.wfile.write(b"0\r\n\r\n")
+            return
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if self.command == "HEAD":
+            return
+        step = 16384
+        for i in range(0, len(body), step):
+            self.wfile.write(body[i:i + step])
+            if ARGS.slow:
+                self.wfile.flush()
+                time.sleep(step / (ARGS.slow * 1024.0))
+
+    def do_HEAD(self):
+        self.do_GET()
+
+    def do_GET(self):
+        moved = redirect_for(self.path)
+        if moved:
+            self.reply(moved[0], [("Location", moved[1])])
+            return
+        path = os.path.join(ARGS.root, self.path.lstrip("/"))
+        if os.path.isdir(path):
+            self.reply(200, [("Content-Type", "text/html")], b"<html></html>")
+            return
+        if os.path.isfile(path):
+            with open(path, "rb") as f:
+                data = f.read()
+            mtime = os.stat(path).st_mtime
+        elif self.path.endswith("/Packages.xz"):
+            data, mtime = BLOB, 0
+        else:
+            self.reply(404, [], b"not found\n")
+            return
+
+        etag = '"%s"' % hashlib.md5(data).hexdigest()[:16]
+        hdrs = [("ETag", etag), ("Last-Modified", email.utils.formatdate(mtime, usegmt=True))]
+        inm = self.headers.get("If-None-Match")
+        ims = self.headers.get("If-Modified-Since")
+        if inm is not None:
+            fresh = inm == etag
+        else:
+            fresh = ims is not None and email.utils.parsedate_to_datetime(ims).timestamp() >= int(mtime)
+        if fresh:
+            self.reply(304, hdrs)
+            return
+
+        rng = self.headers.get("Range", "")
+        if rng.startswith("bytes=") and data:
+            first, _, last = rng[6:].partition("-")
+            first = int(first)
+            last = min(int(last) if last else len(data) - 1, len(data) - 1)
+            hdrs.append(("Content-Range", "bytes %d-%d/%d" % (first, last, len(data))))
+            self.reply(206, hdrs, data[first:last + 1])
+            return
+        self.reply(200, hdrs, data)
+
+
+def main():
+    global ARGS
+    here = os.path.dirname(os.path.abspath(__file__))
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--port", type=int, default=8765)
+    p.add_argument("--root", default=os.path.join(here, "root"))
+    p.add_argument("--http10", action="store_true", help="answer HTTP/1.0, close after each response")
+    p.add_argument("--chunked", action="store_true", help="send bodies with chunked encoding")
+    p.add_argument("--slow", type=int, default=0, metavar="KBPS", help="limit each body to KBPS KiB/s")
+    ARGS = p.parse_args()
+    Handler.protocol_version = "HTTP/1.0" if ARGS.http10 else "HTTP/1.1"
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", ARGS.port), Handler)
+    sys.stderr.write("serving %s on http://127.0.0.1:%d/\n" % (ARGS.root, ARGS.port))
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()